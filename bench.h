@@ -0,0 +1,41 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)bench.h	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#ifndef BENCH_H_SENTRY
+#define BENCH_H_SENTRY
+
+#include <stdint.h>
+#include <time.h>
+
+/*-------------------------------------------------
+	#        1.BENCHMARK HELPERS     #
+------------------------------------------------- */
+/*	What every *Bench() shares: a clock, how long to keep a case
+	running, and a xorshift generator, so runs are repeatable and
+	one module's numbers compare with another's.	*/
+
+#define BENCH_SECONDS 0.25	//each case repeats for at least that long
+
+static inline double BenchNow(void){	//seconds, monotonic
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static inline uint32_t BenchRandom(uint32_t *state){	//state must not be 0
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static inline float BenchUniform(uint32_t *state){	//0..1
+	return (BenchRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+#endif
@@ -0,0 +1,445 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)bvh.c	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bvh.h"
+#include "bench.h"
+
+#define BVH_DEPTH 64	//deeper nodes become leaves, the traversal stack is that big
+#define BVH_LEAF_MAX 32	//bigger leaves are split even when SAH says no
+
+/*-------------------------------------------------
+	#        Boxes and Triangles (static)      #
+------------------------------------------------- */
+
+typedef struct {
+	vec4_t lo, hi;
+} box_t;
+
+static inline box_t EmptyBox(void){
+	box_t b = {vec4_splat(INFINITY), vec4_splat(-INFINITY)};
+	return b;
+}
+
+static inline void GrowBox(box_t *b, vec4_t p){
+	b->lo = vec4_min(b->lo, p);
+	b->hi = vec4_max(b->hi, p);
+}
+
+static inline void MergeBox(box_t *b, const box_t *c){
+	b->lo = vec4_min(b->lo, c->lo);
+	b->hi = vec4_max(b->hi, c->hi);
+}
+
+static inline float HalfArea(const box_t *b){
+	vec4_t d = vec4_sub(b->hi, b->lo);
+	return d.f[X] < 0 ? 0.0f : d.f[X] * d.f[Y] + d.f[Y] * d.f[Z] + d.f[Z] * d.f[X];
+}
+
+static inline box_t TriangleBox(const wavefront_t *obj, const int *t){
+	box_t b;
+	b.lo = b.hi = vec4_load3(obj->vertex[t[0]]);
+	GrowBox(&b, vec4_load3(obj->vertex[t[1]]));
+	GrowBox(&b, vec4_load3(obj->vertex[t[2]]));
+	return b;
+}
+
+static inline void StoreBox(bvh_node_t *n, const box_t *b){
+	vec4_store3(n->lo, b->lo);
+	vec4_store3(n->hi, b->hi);
+}
+
+/*	Moller-Trumbore, both sides. Writes hit and returns 1 when the
+	triangle is crossed at 0 < t < hit->t.	*/
+static inline int HitTriangle(const wavefront_t *obj, const int *t, vec4_t org, vec4_t dir, bvh_hit_t *hit){
+	vec4_t v0 = vec4_load3(obj->vertex[t[0]]);
+	vec4_t e1 = vec4_sub(vec4_load3(obj->vertex[t[1]]), v0);
+	vec4_t e2 = vec4_sub(vec4_load3(obj->vertex[t[2]]), v0);
+	vec4_t p = vec4_cross3(dir, e2);
+	float det = vec4_dot3(e1, p);
+	if(fabsf(det) < 1e-20f)
+		return 0;
+	float inv = 1.0f / det;
+	vec4_t s = vec4_sub(org, v0);
+	float u = vec4_dot3(s, p) * inv;
+	if(u < 0.0f || u > 1.0f)
+		return 0;
+	vec4_t q = vec4_cross3(s, e1);
+	float v = vec4_dot3(dir, q) * inv;
+	if(v < 0.0f || u + v > 1.0f)
+		return 0;
+	float d = vec4_dot3(e2, q) * inv;
+	if(d <= 0.0f || d >= hit->t)
+		return 0;
+	hit->t = d;
+	hit->u = u;
+	hit->v = v;
+	hit->face = t[3];
+	return 1;
+}
+
+//entry distance of the ray into the node, INFINITY when it misses
+static inline float HitNode(const bvh_node_t *n, const float *org, const float *inv, float tmax){
+	float t0 = 0.0f, t1 = tmax;
+	for(int i = 0; i < 3; i++){
+		float a = (n->lo[i] - org[i]) * inv[i];
+		float b = (n->hi[i] - org[i]) * inv[i];
+		t0 = fmaxf(t0, fminf(a, b));
+		t1 = fminf(t1, fmaxf(a, b));
+	}
+	return t0 <= t1 ? t0 : INFINITY;
+}
+
+/*-------------------------------------------------
+	#        Binned SAH Build (static)      #
+------------------------------------------------- */
+
+typedef struct {
+	bvh_t *b;
+	box_t *box;	//of every triangle, kept in tri order
+	vec4_t *cent;	//box centers
+} build_t;
+
+typedef struct {
+	box_t box;
+	int n;
+} bin_t;
+
+static void SwapPrim(build_t *s, int i, int j){
+	int t[4];
+	memcpy(t, s->b->tri[i], sizeof(t));
+	memcpy(s->b->tri[i], s->b->tri[j], sizeof(t));
+	memcpy(s->b->tri[j], t, sizeof(t));
+	box_t bx = s->box[i]; s->box[i] = s->box[j]; s->box[j] = bx;
+	vec4_t c = s->cent[i]; s->cent[i] = s->cent[j]; s->cent[j] = c;
+}
+
+static inline int BinOf(vec4_t c, int axis, float lo, float scale){
+	int k = (int)((c.f[axis] - lo) * scale);
+	return k < 0 ? 0 : (k >= BVH_BINS ? BVH_BINS - 1 : k);
+}
+
+/*	Cost of a split is 1 (the inner node) plus the triangles on each
+	side weighted by the area of their box relative to the parent,
+	a leaf costs one per triangle.	*/
+static void Build(build_t *s, int node, int first, int count, int depth){
+	bvh_node_t *n = &s->b->node[node];
+	box_t bounds = EmptyBox(), cb = EmptyBox();
+	for(int i = first; i < first + count; i++){
+		MergeBox(&bounds, &s->box[i]);
+		GrowBox(&cb, s->cent[i]);
+	}
+	StoreBox(n, &bounds);
+	n->first = first;
+	n->count = count;
+	if(count <= BVH_LEAF || depth >= BVH_DEPTH)
+		return;
+	float best = INFINITY, area = HalfArea(&bounds);
+	int axis = -1, split = 0;
+	for(int a = 0; a < 3; a++){
+		float lo = cb.lo.f[a], extent = cb.hi.f[a] - lo;
+		if(!(extent > 0.0f))
+			continue;
+		float scale = BVH_BINS / extent;
+		bin_t bin[BVH_BINS];
+		for(int k = 0; k < BVH_BINS; k++){
+			bin[k].box = EmptyBox();
+			bin[k].n = 0;
+		}
+		for(int i = first; i < first + count; i++){
+			bin_t *p = &bin[BinOf(s->cent[i], a, lo, scale)];
+			MergeBox(&p->box, &s->box[i]);
+			p->n++;
+		}
+		float right[BVH_BINS];	//area * count of bins k.. on the right
+		box_t acc = EmptyBox();
+		int nr = 0;
+		for(int k = BVH_BINS - 1; k > 0; k--){
+			MergeBox(&acc, &bin[k].box);
+			nr += bin[k].n;
+			right[k] = nr ? HalfArea(&acc) * nr : 0.0f;
+		}
+		acc = EmptyBox();
+		int nl = 0;
+		for(int k = 1; k < BVH_BINS; k++){	//left: bins 0..k-1
+			MergeBox(&acc, &bin[k - 1].box);
+			nl += bin[k - 1].n;
+			if(nl == 0 || nl == count)
+				continue;
+			float cost = HalfArea(&acc) * nl + right[k];
+			if(cost < best){
+				best = cost;
+				axis = a;
+				split = k;
+			}
+		}
+	}
+	if(axis < 0 || (area > 0 && 1.0f + best / area >= count && count <= BVH_LEAF_MAX))
+		return;	//all centers in one spot, or not worth it
+	float lo = cb.lo.f[axis], scale = BVH_BINS / (cb.hi.f[axis] - lo);
+	int i = first, j = first + count - 1;
+	while(i <= j){
+		if(BinOf(s->cent[i], axis, lo, scale) < split)
+			i++;
+		else
+			SwapPrim(s, i, j--);
+	}
+	int child = s->b->nodes;
+	s->b->nodes += 2;
+	n->first = child;
+	n->count = 0;
+	Build(s, child, first, i - first, depth + 1);
+	Build(s, child + 1, i, first + count - i, depth + 1);
+}
+
+/*-------------------------------------------------
+	#        1. Main Public      #
+------------------------------------------------- */
+
+bvh_t *BuildBvh(const wavefront_t *obj){
+	int ntri = obj->tc;
+	bvh_t *b = calloc(1, sizeof(bvh_t));
+	build_t s = {b, NULL, NULL};
+	if(b){
+		b->tri = malloc(sizeof(int[4]) * (ntri ? ntri : 1));
+		b->node = malloc(sizeof(bvh_node_t) * (ntri ? 2 * ntri - 1 : 1));
+		s.box = malloc(sizeof(box_t) * (ntri ? ntri : 1));
+		s.cent = malloc(sizeof(vec4_t) * (ntri ? ntri : 1));
+	}
+	if(!b || !b->tri || !b->node || !s.box || !s.cent){
+		fprintf(stderr," (err) bvh.c: Can't allocate %i triangles\n", ntri);
+		free(s.box);
+		free(s.cent);
+		RemoveBvh(b);
+		return NULL;
+	}
+	for(int i = 0; i < ntri; i++){
+		int *t = b->tri[i];
+		t[0] = obj->tri[3 * i];
+		t[1] = obj->tri[3 * i + 1];
+		t[2] = obj->tri[3 * i + 2];
+		t[3] = obj->tface[i];
+		s.box[i] = TriangleBox(obj, t);
+		s.cent[i] = vec4_scale(vec4_add(s.box[i].lo, s.box[i].hi), 0.5f);
+	}
+	b->ntri = ntri;
+	b->nodes = 1;
+	Build(&s, 0, 0, b->ntri, 0);
+	free(s.box);
+	free(s.cent);
+	return b;
+}
+
+/*	Children come after their parent, so one backward pass sees
+	both children of a node before the node itself.	*/
+void RefitBvh(bvh_t *b, const wavefront_t *obj){
+	if(b->ntri == 0)
+		return;	//the lone empty root has no children to read
+	for(int i = b->nodes - 1; i >= 0; i--){
+		bvh_node_t *n = &b->node[i];
+		box_t box = EmptyBox();
+		if(n->count){
+			for(int k = n->first; k < n->first + n->count; k++){
+				box_t t = TriangleBox(obj, b->tri[k]);
+				MergeBox(&box, &t);
+			}
+		} else {
+			const bvh_node_t *c = &b->node[n->first];
+			for(int k = 0; k < 2; k++){
+				GrowBox(&box, vec4_load3(c[k].lo));
+				GrowBox(&box, vec4_load3(c[k].hi));
+			}
+		}
+		StoreBox(n, &box);
+	}
+}
+
+void RemoveBvh(bvh_t *b){
+	if(b == NULL)
+		return;
+	free(b->node);
+	free(b->tri);
+	free(b);
+}
+
+/*	Near child first; any - return at the first hit (hit->t is then
+	just some t < tmax). The far child stays on the stack with its
+	entry distance, and is skipped if something closer was hit.	*/
+static int Traverse(const bvh_t *b, const wavefront_t *obj, const float org[3], const float dir[3],
+		bvh_hit_t *hit, int any){
+	if(b->ntri == 0)
+		return 0;
+	vec4_t o = vec4_load3(org), d = vec4_load3(dir);
+	float inv[3] = {1.0f / dir[X], 1.0f / dir[Y], 1.0f / dir[Z]};
+	struct {int node; float t;} stack[BVH_DEPTH + 2];
+	int sp = 0, found = 0;
+	if(HitNode(&b->node[0], org, inv, hit->t) == INFINITY)
+		return 0;
+	stack[sp].node = 0;
+	stack[sp++].t = 0.0f;
+	while(sp > 0){
+		sp--;
+		if(stack[sp].t >= hit->t)
+			continue;
+		const bvh_node_t *n = &b->node[stack[sp].node];
+		while(n->count == 0){
+			const bvh_node_t *c = &b->node[n->first];
+			float t0 = HitNode(&c[0], org, inv, hit->t);
+			float t1 = HitNode(&c[1], org, inv, hit->t);
+			if(t0 == INFINITY && t1 == INFINITY){
+				n = NULL;
+				break;
+			}
+			if(t1 < t0){
+				float t = t0; t0 = t1; t1 = t;
+				c++;	//c[0] - the near one, c[-1] - the far one
+				if(t1 != INFINITY){
+					stack[sp].node = (int)(c - 1 - b->node);
+					stack[sp++].t = t1;
+				}
+			} else if(t1 != INFINITY){
+				stack[sp].node = (int)(c + 1 - b->node);
+				stack[sp++].t = t1;
+			}
+			n = c;
+		}
+		if(n == NULL)
+			continue;
+		for(int k = n->first; k < n->first + n->count; k++)
+			if(HitTriangle(obj, b->tri[k], o, d, hit)){
+				found = 1;
+				if(any)
+					return 1;
+			}
+	}
+	return found;
+}
+
+int BvhIntersect(const bvh_t *b, const wavefront_t *obj, const float org[3], const float dir[3],
+		float tmax, bvh_hit_t *hit){
+	hit->t = tmax;
+	hit->face = -1;
+	return Traverse(b, obj, org, dir, hit, 0);
+}
+
+int BvhOccluded(const bvh_t *b, const wavefront_t *obj, const float org[3], const float dir[3],
+		float tmax){
+	bvh_hit_t hit = {tmax, 0.0f, 0.0f, -1};
+	return Traverse(b, obj, org, dir, &hit, 1);
+}
+
+/*	The world ray goes into obj's space unnormalized, so hit->t
+	is the same along both.	*/
+int BvhPick(const bvh_t *b, const wavefront_t *obj, const mat4_t *model, raster_t *r, int x, int y,
+		bvh_hit_t *hit){
+	float org[3], dir[3];
+	mat4_t inv;
+	RasterScreenRay(r, x + 0.5f, y + 0.5f, org, dir);
+	if(model){
+		if(mat4_inverse_affine(model, &inv) != 0){
+			hit->t = INFINITY;
+			hit->face = -1;
+			return 0;	//flattened, nothing to hit
+		}
+		vec4_store3(org, mat4_apply(&inv, vec4_set(org[X], org[Y], org[Z], 1.0f)));
+		vec4_store3(dir, mat4_apply(&inv, vec4_set(dir[X], dir[Y], dir[Z], 0.0f)));
+	}
+	return BvhIntersect(b, obj, org, dir, INFINITY, hit);
+}
+
+/*-------------------------------------------------
+	#        2. Benchmark      #
+------------------------------------------------- */
+
+#define BENCH_RAYS (1 << 16)
+#define BENCH_CHECK 256	//rays also traced by brute force
+
+static int BruteIntersect(const wavefront_t *obj, const float org[3], const float dir[3], bvh_hit_t *hit){
+	vec4_t o = vec4_load3(org), d = vec4_load3(dir);
+	int found = 0;
+	hit->t = INFINITY;
+	hit->face = -1;
+	for(int i = 0; i < obj->tc; i++){
+		int t[4] = {obj->tri[3 * i], obj->tri[3 * i + 1], obj->tri[3 * i + 2], obj->tface[i]};
+		found |= HitTriangle(obj, t, o, d, hit);
+	}
+	return found;
+}
+
+/*	Rays from a sphere around the mesh to random points of its box */
+void BvhBench(const wavefront_t *obj){
+	float (*org)[3] = malloc(sizeof(float[3]) * BENCH_RAYS);
+	float (*dir)[3] = malloc(sizeof(float[3]) * BENCH_RAYS);
+	if(!org || !dir){
+		free(org);
+		free(dir);
+		return;
+	}
+	uint32_t seed = 7;
+	for(int i = 0; i < BENCH_RAYS; i++){
+		float z = 2.0f * BenchUniform(&seed) - 1.0f, a = 2.0f * (float)M_PI * BenchUniform(&seed);
+		float s = sqrtf(1.0f - z * z), r = 2.0f * obj->radius + 1e-3f;
+		org[i][X] = obj->center[X] + r * s * cosf(a);
+		org[i][Y] = obj->center[Y] + r * s * sinf(a);
+		org[i][Z] = obj->center[Z] + r * z;
+		for(int k = 0; k < 3; k++)
+			dir[i][k] = obj->bmin[k] + (obj->bmax[k] - obj->bmin[k]) * BenchUniform(&seed) - org[i][k];
+	}
+	double t0 = BenchNow();
+	bvh_t *b = BuildBvh(obj);
+	double build = BenchNow() - t0;
+	if(b == NULL){
+		free(org);
+		free(dir);
+		return;
+	}
+	int runs = 0;
+	t0 = BenchNow();
+	do {
+		RefitBvh(b, obj);
+		runs++;
+	} while(BenchNow() - t0 < BENCH_SECONDS);
+	double refit = (BenchNow() - t0) / runs;
+	printf("bvh.c: %i triangles, %i nodes, build %.2f ms, refit %.2f ms\n",
+		b->ntri, b->nodes, build * 1e3, refit * 1e3);
+	int bad = 0;
+	long hits = 0;
+	double brute = 0.0;
+	for(int i = 0; i < BENCH_CHECK; i++){
+		bvh_hit_t h1, h2;
+		int a = BvhIntersect(b, obj, org[i], dir[i], INFINITY, &h1);
+		t0 = BenchNow();
+		int c = BruteIntersect(obj, org[i], dir[i], &h2);
+		brute += BenchNow() - t0;
+		bad += a != c || (a && h1.t != h2.t) || a != BvhOccluded(b, obj, org[i], dir[i], INFINITY);
+	}
+	for(int any = 0; any < 2; any++){
+		long rays = 0;
+		t0 = BenchNow();
+		do {
+			for(int i = 0; i < BENCH_RAYS; i++){
+				bvh_hit_t h;
+				hits += any ? BvhOccluded(b, obj, org[i], dir[i], INFINITY) :
+					BvhIntersect(b, obj, org[i], dir[i], INFINITY, &h);
+			}
+			rays += BENCH_RAYS;
+		} while(BenchNow() - t0 < BENCH_SECONDS);
+		double t = BenchNow() - t0;
+		printf("bvh.c: %-9s %8.2f Mrays/s %8.3f us/ray, %.0f%% hit\n", any ? "any-hit" : "first-hit",
+			rays / t * 1e-6, t / rays * 1e6, 100.0 * hits / rays);
+		hits = 0;
+	}
+	printf("bvh.c: brute force %8.3f us/ray, %i mismatches in %i rays\n",
+		brute / BENCH_CHECK * 1e6, bad, BENCH_CHECK);
+	RemoveBvh(b);
+	free(org);
+	free(dir);
+}
@@ -0,0 +1,61 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)bvh.h	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#ifndef BVH_H_SENTRY
+#define BVH_H_SENTRY
+
+#include "wavefront.h"
+#include "raster.h"
+
+/*-------------------------------------------------
+	#        1.BOUNDING VOLUME HIERARCHY     #
+------------------------------------------------- */
+/*	Over the triangles of obj->tri, built top-down with a
+	binned SAH. Nodes live in one array, depth first: the children
+	of an inner node are node[first] and node[first + 1], so every
+	child comes after its parent.	*/
+
+#define BVH_BINS 16
+#define BVH_LEAF 4	//triangles a leaf may keep
+
+typedef struct {
+	float lo[3];
+	int first;	//leaf: first triangle; inner: left child
+	float hi[3];
+	int count;	//triangles, 0 - inner node
+} bvh_node_t;	//32 bytes, two per cache line
+
+//MAIN SUBJECT:
+typedef struct {
+	bvh_node_t *node;
+	int nodes;
+	int (*tri)[4];	//vertex numbers (from 0) and the face, in leaf order
+	int ntri;
+} bvh_t;
+
+typedef struct {
+	float t;	//point = org + t * dir
+	float u, v;	//barycentrics of the 2nd and 3rd points
+	int face;
+} bvh_hit_t;
+
+//FUNCS
+bvh_t *BuildBvh(const wavefront_t *obj);
+void RefitBvh(bvh_t *b, const wavefront_t *obj);	//after the vertices moved, same faces
+void RemoveBvh(bvh_t *b);
+/*	Both faces of a triangle are hit. Rays are in the space of
+	obj's vertices, dir needn't be unit length. 1 - hit, 0 - none */
+int BvhIntersect(const bvh_t *b, const wavefront_t *obj, const float org[3], const float dir[3],
+		float tmax, bvh_hit_t *hit);	//closest hit with t in (0, tmax)
+int BvhOccluded(const bvh_t *b, const wavefront_t *obj, const float org[3], const float dir[3],
+		float tmax);	//any hit, stops at the first one
+int BvhPick(const bvh_t *b, const wavefront_t *obj, const mat4_t *model, raster_t *r, int x, int y,
+		bvh_hit_t *hit);	//the face under pixel (x, y) of r's last frame, obj drawn with model (NULL - none)
+void BvhBench(const wavefront_t *obj);	//prints build, refit and query times
+
+#endif
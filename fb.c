@@ -0,0 +1,399 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)fb.c	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define FB_X86 1
+#endif
+#include "fb.h"
+#include "bench.h"
+
+/*-------------------------------------------------
+	#        Row Kernels (static)      #
+------------------------------------------------- */
+/*	One row at a time, the SIMD ones do the 4 or 8 pixel body and
+	leave the tail to the scalar kernel. All of them give the same
+	bits: blend is v = s*a + d*(255-a) + 128, (v + (v >> 8)) >> 8
+	per channel, the x byte ends up 0.	*/
+
+typedef struct {
+	int r, g, b;	//8.8 fixed point
+} gradient_t;
+
+typedef struct {
+	void (*Fill)(uint32_t *dst, uint32_t pixel, int n);
+	void (*Gradient)(uint32_t *dst, int n, gradient_t c, fb_step_t dx, const io_format_t *f);
+	void (*Blend)(uint32_t *dst, const uint32_t *src, int n, int swap);
+} kernels_t;
+
+static inline uint32_t Swap(uint32_t c){	//0xAARRGGBB <-> 0xAABBGGRR
+	return (c & 0xFF00FF00u) | (c >> 16 & 0xFF) | (c & 0xFF) << 16;
+}
+
+static void FillScalar(uint32_t *dst, uint32_t pixel, int n){
+	for(int i = 0; i < n; i++)
+		dst[i] = pixel;
+}
+
+static void GradientScalar(uint32_t *dst, int n, gradient_t c, fb_step_t dx, const io_format_t *f){
+	for(int i = 0; i < n; i++, c.r += dx.r, c.g += dx.g, c.b += dx.b)
+		dst[i] = (uint32_t)(c.r >> 8 & 0xFF) << f->rshift |
+			(uint32_t)(c.g >> 8 & 0xFF) << f->gshift |
+			(uint32_t)(c.b >> 8 & 0xFF) << f->bshift;
+}
+
+static void BlendScalar(uint32_t *dst, const uint32_t *src, int n, int swap){
+	for(int i = 0; i < n; i++){
+		uint32_t s = swap ? Swap(src[i]) : src[i], d = dst[i], a = s >> 24, out = 0;
+		for(int k = 0; k < 24; k += 8){
+			uint32_t v = (s >> k & 0xFF) * a + (d >> k & 0xFF) * (255 - a) + 128;
+			out |= ((v + (v >> 8)) >> 8) << k;
+		}
+		dst[i] = out;
+	}
+}
+
+#ifdef FB_X86
+
+static void FillSSE2(uint32_t *dst, uint32_t pixel, int n){
+	__m128i v = _mm_set1_epi32((int)pixel);
+	int i = 0;
+	for(; i + 4 <= n; i += 4)
+		_mm_storeu_si128((__m128i *)(dst + i), v);
+	FillScalar(dst + i, pixel, n - i);
+}
+
+static inline __m128i Channel4(__m128i v, __m128i shift){
+	return _mm_sll_epi32(_mm_and_si128(_mm_srai_epi32(v, 8), _mm_set1_epi32(0xFF)), shift);
+}
+
+static void GradientSSE2(uint32_t *dst, int n, gradient_t c, fb_step_t dx, const io_format_t *f){
+	__m128i r = _mm_setr_epi32(c.r, c.r + dx.r, c.r + 2 * dx.r, c.r + 3 * dx.r);
+	__m128i g = _mm_setr_epi32(c.g, c.g + dx.g, c.g + 2 * dx.g, c.g + 3 * dx.g);
+	__m128i b = _mm_setr_epi32(c.b, c.b + dx.b, c.b + 2 * dx.b, c.b + 3 * dx.b);
+	__m128i sr = _mm_cvtsi32_si128(f->rshift), sg = _mm_cvtsi32_si128(f->gshift);
+	__m128i sb = _mm_cvtsi32_si128(f->bshift);
+	__m128i dr = _mm_set1_epi32(4 * dx.r), dg = _mm_set1_epi32(4 * dx.g), db = _mm_set1_epi32(4 * dx.b);
+	int i = 0;
+	for(; i + 4 <= n; i += 4){
+		__m128i p = _mm_or_si128(_mm_or_si128(Channel4(r, sr), Channel4(g, sg)), Channel4(b, sb));
+		_mm_storeu_si128((__m128i *)(dst + i), p);
+		r = _mm_add_epi32(r, dr);
+		g = _mm_add_epi32(g, dg);
+		b = _mm_add_epi32(b, db);
+	}
+	c.r += i * dx.r; c.g += i * dx.g; c.b += i * dx.b;
+	GradientScalar(dst + i, n - i, c, dx, f);
+}
+
+static inline __m128i Swap4(__m128i c){
+	__m128i lo = _mm_and_si128(_mm_srli_epi32(c, 16), _mm_set1_epi32(0xFF));
+	__m128i hi = _mm_slli_epi32(_mm_and_si128(c, _mm_set1_epi32(0xFF)), 16);
+	return _mm_or_si128(_mm_or_si128(lo, hi), _mm_and_si128(c, _mm_set1_epi32((int)0xFF00FF00u)));
+}
+
+//8 channels of 2 pixels in 16-bit lanes
+static inline __m128i Blend2(__m128i s, __m128i d){
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+	__m128i v = _mm_add_epi16(_mm_mullo_epi16(s, a),
+		_mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), a)));
+	v = _mm_add_epi16(v, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+}
+
+static void BlendSSE2(uint32_t *dst, const uint32_t *src, int n, int swap){
+	__m128i zero = _mm_setzero_si128(), mask = _mm_set1_epi32(0xFFFFFF);
+	int i = 0;
+	for(; i + 4 <= n; i += 4){
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		if(swap)
+			s = Swap4(s);
+		__m128i lo = Blend2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+		__m128i hi = Blend2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(_mm_packus_epi16(lo, hi), mask));
+	}
+	BlendScalar(dst + i, src + i, n - i, swap);
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static void FillAVX2(uint32_t *dst, uint32_t pixel, int n){
+	__m256i v = _mm256_set1_epi32((int)pixel);
+	int i = 0;
+	for(; i + 8 <= n; i += 8)
+		_mm256_storeu_si256((__m256i *)(dst + i), v);
+	FillScalar(dst + i, pixel, n - i);
+}
+
+AVX2 static inline __m256i Channel8(__m256i v, int shift){
+	return _mm256_sll_epi32(_mm256_and_si256(_mm256_srai_epi32(v, 8), _mm256_set1_epi32(0xFF)),
+		_mm_cvtsi32_si128(shift));
+}
+
+AVX2 static void GradientAVX2(uint32_t *dst, int n, gradient_t c, fb_step_t dx, const io_format_t *f){
+	__m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i r = _mm256_add_epi32(_mm256_set1_epi32(c.r), _mm256_mullo_epi32(lane, _mm256_set1_epi32(dx.r)));
+	__m256i g = _mm256_add_epi32(_mm256_set1_epi32(c.g), _mm256_mullo_epi32(lane, _mm256_set1_epi32(dx.g)));
+	__m256i b = _mm256_add_epi32(_mm256_set1_epi32(c.b), _mm256_mullo_epi32(lane, _mm256_set1_epi32(dx.b)));
+	__m256i dr = _mm256_set1_epi32(8 * dx.r), dg = _mm256_set1_epi32(8 * dx.g), db = _mm256_set1_epi32(8 * dx.b);
+	int i = 0;
+	for(; i + 8 <= n; i += 8){
+		__m256i p = _mm256_or_si256(_mm256_or_si256(Channel8(r, f->rshift), Channel8(g, f->gshift)),
+			Channel8(b, f->bshift));
+		_mm256_storeu_si256((__m256i *)(dst + i), p);
+		r = _mm256_add_epi32(r, dr);
+		g = _mm256_add_epi32(g, dg);
+		b = _mm256_add_epi32(b, db);
+	}
+	c.r += i * dx.r; c.g += i * dx.g; c.b += i * dx.b;
+	GradientScalar(dst + i, n - i, c, dx, f);
+}
+
+AVX2 static inline __m256i Blend4(__m256i s, __m256i d){
+	__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xFF), 0xFF);
+	__m256i v = _mm256_add_epi16(_mm256_mullo_epi16(s, a),
+		_mm256_mullo_epi16(d, _mm256_sub_epi16(_mm256_set1_epi16(255), a)));
+	v = _mm256_add_epi16(v, _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)), 8);
+}
+
+AVX2 static void BlendAVX2(uint32_t *dst, const uint32_t *src, int n, int swap){
+	__m256i zero = _mm256_setzero_si256(), mask = _mm256_set1_epi32(0xFFFFFF);
+	__m256i swiz = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	int i = 0;
+	for(; i + 8 <= n; i += 8){
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+		if(swap)
+			s = _mm256_shuffle_epi8(s, swiz);
+		__m256i lo = Blend4(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+		__m256i hi = Blend4(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_and_si256(_mm256_packus_epi16(lo, hi), mask));
+	}
+	BlendScalar(dst + i, src + i, n - i, swap);
+}
+
+#endif	//FB_X86
+
+static const kernels_t Kernels[] = {
+	[FB_SCALAR] = {FillScalar, GradientScalar, BlendScalar},
+#ifdef FB_X86
+	[FB_SSE2] = {FillSSE2, GradientSSE2, BlendSSE2},
+	[FB_AVX2] = {FillAVX2, GradientAVX2, BlendAVX2},
+#endif
+};
+
+static int Best = FB_SCALAR;	//what the CPU runs
+static const kernels_t *K = &Kernels[FB_SCALAR];
+static pthread_once_t Once = PTHREAD_ONCE_INIT;
+
+static void Detect(void){
+#ifdef FB_X86
+	__builtin_cpu_init();
+	Best = __builtin_cpu_supports("avx2") ? FB_AVX2 : FB_SSE2;
+#endif
+	K = &Kernels[Best];
+}
+
+/*-------------------------------------------------
+	#        Clipping (static)      #
+------------------------------------------------- */
+
+typedef struct {
+	int x, y, w, h;
+	int dx, dy;	//how much the left/top edge moved in
+} clip_t;
+
+static int IsSupported(const io_framebuffer_t *fb){
+	return fb->format.layout == IO_XRGB8888 || fb->format.layout == IO_XBGR8888;
+}
+
+static int Clip(const io_framebuffer_t *fb, clip_t *c, int x, int y, int w, int h){
+	c->dx = x < 0 ? -x : 0;
+	c->dy = y < 0 ? -y : 0;
+	c->x = x + c->dx;
+	c->y = y + c->dy;
+	c->w = (x + w > fb->width ? fb->width - x : w) - c->dx;
+	c->h = (y + h > fb->height ? fb->height - y : h) - c->dy;
+	return c->w > 0 && c->h > 0;
+}
+
+static inline uint32_t *Row(const io_framebuffer_t *fb, int x, int y){
+	return (uint32_t *)(fb->pixels + (size_t)y * fb->pitch) + x;
+}
+
+static uint32_t Native(const io_format_t *f, unsigned int color){
+	return (color >> 16 & 0xFF) << f->rshift | (color >> 8 & 0xFF) << f->gshift |
+		(color & 0xFF) << f->bshift;
+}
+
+/*-------------------------------------------------
+	#        1. Main Public      #
+------------------------------------------------- */
+
+int FbSetIsa(int isa){
+	pthread_once(&Once, Detect);
+	if(isa < 0 || isa > Best)
+		isa = Best;
+	K = &Kernels[isa];
+	return isa;
+}
+
+int FbFill(io_framebuffer_t *fb, int x, int y, int width, int height, unsigned int color){
+	clip_t c;
+	pthread_once(&Once, Detect);
+	if(!IsSupported(fb))
+		return -1;
+	if(!Clip(fb, &c, x, y, width, height))
+		return 0;
+	uint32_t pixel = Native(&fb->format, color);
+	for(int j = 0; j < c.h; j++)
+		K->Fill(Row(fb, c.x, c.y + j), pixel, c.w);
+	return 0;
+}
+
+int FbGradient(io_framebuffer_t *fb, int x, int y, int width, int height,
+		unsigned int color, fb_step_t dx, fb_step_t dy){
+	clip_t c;
+	pthread_once(&Once, Detect);
+	if(!IsSupported(fb))
+		return -1;
+	if(!Clip(fb, &c, x, y, width, height))
+		return 0;
+	gradient_t g = {(int)(color >> 16 & 0xFF) << 8, (int)(color >> 8 & 0xFF) << 8, (int)(color & 0xFF) << 8};
+	g.r += c.dx * dx.r + c.dy * dy.r;
+	g.g += c.dx * dx.g + c.dy * dy.g;
+	g.b += c.dx * dx.b + c.dy * dy.b;
+	for(int j = 0; j < c.h; j++, g.r += dy.r, g.g += dy.g, g.b += dy.b)
+		K->Gradient(Row(fb, c.x, c.y + j), c.w, g, dx, &fb->format);
+	return 0;
+}
+
+/*	Rows are moved with memmove, libc already picks the widest copy
+	the CPU has. Bottom-up when dst is below src in the same image. */
+int FbCopy(io_framebuffer_t *dst, int x, int y, const io_framebuffer_t *src,
+		int sx, int sy, int width, int height){
+	clip_t c, s;
+	if(!IsSupported(dst) || src->format.layout != dst->format.layout)
+		return -1;
+	if(!Clip(src, &s, sx, sy, width, height))
+		return 0;
+	if(!Clip(dst, &c, x + s.dx, y + s.dy, s.w, s.h))
+		return 0;
+	sx = s.x + c.dx;
+	sy = s.y + c.dy;
+	int up = dst->pixels == src->pixels && c.y > sy;
+	for(int j = 0; j < c.h; j++){
+		int row = up ? c.h - 1 - j : j;
+		memmove(Row(dst, c.x, c.y + row), Row(src, sx, sy + row), sizeof(uint32_t) * c.w);
+	}
+	return 0;
+}
+
+int FbBlend(io_framebuffer_t *fb, int x, int y, int width, int height,
+		const unsigned int *colors, int stride){
+	clip_t c;
+	pthread_once(&Once, Detect);
+	if(!IsSupported(fb))
+		return -1;
+	if(!Clip(fb, &c, x, y, width, height))
+		return 0;
+	colors += (long)c.dy * stride + c.dx;
+	int swap = fb->format.layout == IO_XBGR8888;
+	for(int j = 0; j < c.h; j++)
+		K->Blend(Row(fb, c.x, c.y + j), colors + (long)j * stride, c.w, swap);
+	return 0;
+}
+
+/*-------------------------------------------------
+	#        2. Check and Benchmark      #
+------------------------------------------------- */
+
+#define CHECK_W 67	//odd, so every kernel has a tail
+#define CHECK_H 5
+
+int FbCheck(void){
+	static const io_format_t formats[2] = {{4, 16, 8, 0, IO_XRGB8888}, {4, 0, 8, 16, IO_XBGR8888}};
+	uint32_t ref[CHECK_W * CHECK_H], out[CHECK_W * CHECK_H], src[CHECK_W * CHECK_H], seed = 1;
+	int bad = 0, best = FbSetIsa(-1);
+	for(int i = 0; i < CHECK_W * CHECK_H; i++)
+		src[i] = BenchRandom(&seed);
+	for(int isa = FB_SSE2; isa <= best; isa++)
+		for(int f = 0; f < 2; f++){
+			io_framebuffer_t a = {(unsigned char *)ref, CHECK_W * 4, CHECK_W, CHECK_H, formats[f], NULL};
+			io_framebuffer_t b = {(unsigned char *)out, CHECK_W * 4, CHECK_W, CHECK_H, formats[f], NULL};
+			fb_step_t dx = {300, -77, 5}, dy = {-40, 256, 1000};
+			for(int k = 0; k < 3; k++){
+				for(int i = 0; i < CHECK_W * CHECK_H; i++)
+					ref[i] = out[i] = BenchRandom(&seed) & 0xFFFFFF;
+				for(int run = 0; run < 2; run++){
+					io_framebuffer_t *fb = run ? &b : &a;
+					FbSetIsa(run ? isa : FB_SCALAR);
+					if(k == 0) FbFill(fb, -3, 1, CHECK_W, 3, 0x123456);
+					if(k == 1) FbGradient(fb, -5, -2, CHECK_W + 3, CHECK_H + 2, 0x80FF01, dx, dy);
+					if(k == 2) FbBlend(fb, 1, 0, CHECK_W - 1, CHECK_H, src, CHECK_W);
+				}
+				for(int i = 0; i < CHECK_W * CHECK_H; i++)
+					bad += ref[i] != out[i];
+			}
+		}
+	FbSetIsa(-1);
+	return bad;
+}
+
+#define BENCH_W 1920
+#define BENCH_H 1080
+
+void FbBench(void){
+	static const char *names[] = {"scalar", "sse2", "avx2"};
+	static const char *kernels[] = {"fill", "gradient", "copy", "blend"};
+	size_t bytes = (size_t)BENCH_W * BENCH_H * 4;
+	unsigned char *pixels = aligned_alloc(64, bytes * 2);
+	unsigned int *layer = aligned_alloc(64, bytes);
+	if(!pixels || !layer){
+		free(pixels);
+		free(layer);
+		return;
+	}
+	uint32_t seed = 7;
+	for(size_t i = 0; i < (size_t)BENCH_W * BENCH_H; i++)
+		layer[i] = BenchRandom(&seed);
+	memset(pixels, 0, bytes * 2);
+	io_framebuffer_t fb = {pixels, BENCH_W * 4, BENCH_W, BENCH_H, {4, 16, 8, 0, IO_XRGB8888}, NULL};
+	io_framebuffer_t back = fb;
+	back.pixels += bytes;
+	fb_step_t dx = {256, 0, 0}, dy = {0, 256, 0};
+	int best = FbSetIsa(-1);
+	for(int isa = FB_SCALAR; isa <= best; isa++){
+		FbSetIsa(isa);
+		for(int k = 0; k < 4; k++){
+			long frames = 0;
+			double t0 = BenchNow(), t;
+			do {
+				if(k == 0) FbFill(&fb, 0, 0, BENCH_W, BENCH_H, (unsigned int)frames);
+				if(k == 1) FbGradient(&fb, 0, 0, BENCH_W, BENCH_H, 0x80, dx, dy);
+				if(k == 2) FbCopy(&fb, 0, 0, &back, 0, 0, BENCH_W, BENCH_H);
+				if(k == 3) FbBlend(&fb, 0, 0, BENCH_W, BENCH_H, layer, BENCH_W);
+				frames++;
+			} while((t = BenchNow() - t0) < BENCH_SECONDS);
+			double moved = (double)bytes * frames * (k >= 2 ? 2 : 1);	//copy, blend read too
+			printf("fb.c: %-6s %-8s %8.2f GB/s %8.3f ms/frame (%ix%i)\n", names[isa], kernels[k],
+				moved / t * 1e-9, t * 1e3 / frames, BENCH_W, BENCH_H);
+		}
+	}
+	FbSetIsa(-1);
+	free(pixels);
+	free(layer);
+}
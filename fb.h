@@ -0,0 +1,42 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)fb.h	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#ifndef FB_H_SENTRY
+#define FB_H_SENTRY
+
+#include "io.h"
+
+/*-------------------------------------------------
+	#        1.FRAMEBUFFER KERNELS     #
+------------------------------------------------- */
+/*	Work on a locked io_framebuffer_t of an 8888 layout (xRGB or
+	xBGR), rects are clipped to it. Every call returns 0, or -1
+	when the layout isn't supported and nothing was written.	*/
+
+enum fb_isa {FB_SCALAR, FB_SSE2, FB_AVX2};
+
+typedef struct {
+	int r, g, b;	//per pixel, 8.8 fixed point
+} fb_step_t;
+
+//FUNCS
+int FbSetIsa(int isa);	//-1 - the best the CPU has (default); returns the one in use
+int FbFill(io_framebuffer_t *fb, int x, int y, int width, int height, unsigned int color);
+/*	Pixel (x+i, y+j) gets color + i*dx + j*dy per channel, channels
+	wrap modulo 256: RGB(0,0,128) with dx = {256,0,0}, dy = {0,256,0}
+	is the red/green ramp of RGB(x, y, 128).	*/
+int FbGradient(io_framebuffer_t *fb, int x, int y, int width, int height,
+		unsigned int color, fb_step_t dx, fb_step_t dy);
+int FbCopy(io_framebuffer_t *dst, int x, int y, const io_framebuffer_t *src,
+		int sx, int sy, int width, int height);	//may overlap, same layout
+int FbBlend(io_framebuffer_t *fb, int x, int y, int width, int height,
+		const unsigned int *colors, int stride);	//0xAARRGGBB over the pixels
+int FbCheck(void);	//runs every kernel against the scalar one, returns mismatches
+void FbBench(void);	//prints the bandwidth of every kernel and ISA
+
+#endif
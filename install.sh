@@ -1,2 +1,13 @@
 gcc -c io_xlib.c -o io.o
-gcc main.c io.o -lX11 -lXext
+gcc -c wavefront.c -o wavefront.o
+gcc -c raster.c -o raster.o
+gcc -c fb.c -o fb.o
+gcc -c transform.c -o transform.o
+gcc -c vecmath.c -o vecmath.o
+gcc -c bvh.c -o bvh.o
+gcc -c lod.c -o lod.o
+gcc -c texture.c -o texture.o
+gcc main.c io.o wavefront.o raster.o fb.o transform.o vecmath.o bvh.o lod.o texture.o -lX11 -lXext -lm -lpthread
+# headless build: io_memory.c instead of io_xlib.c, no X server needed
+gcc -c io_memory.c -o io_memory.o
+gcc main.c io_memory.o wavefront.o raster.o fb.o transform.o vecmath.o bvh.o lod.o texture.o -lm -lpthread -o headless
@@ -16,6 +16,7 @@
 
 #define DEFAULT_WINDOW_WIDTH 800
 #define DEFAULT_WINDOW_HEIGHT 600
+#define DEFAULT_PRESENT_BUFFERS 2
 
 //MAIN SUBJECT:
 typedef struct io_window_inc_t io_window_t;
@@ -27,6 +28,65 @@ int io_GetHeight(io_window_t *w);
 void io_SetPixel(io_window_t *w, int x, int y, unsigned int color);
 unsigned int io_GetPixel(io_window_t *w, int x, int y);
 void io_UpdateFrame(io_window_t *w);
+/*	1 - one image, the next frame is drawn while the server may still
+	read it; 2..3 - images rotate, io_UpdateFrame returns without
+	waiting for the one it showed. Returns the count in use.	*/
+int io_SetPresentBuffers(io_window_t *w, int n);
+
+//BULK WRITES (0xRRGGBB, clipped to the window):
+void io_WriteSpan(io_window_t *w, int x, int y, const unsigned int *colors, int n);
+void io_WriteRect(io_window_t *w, int x, int y, int width, int height,
+		const unsigned int *colors, int stride);	//stride - colors per source row
+void io_Clear(io_window_t *w, unsigned int color);
+
+//DIRECT ACCESS:
+enum io_layout {
+	IO_XRGB8888,	//32-bit words 0x00RRGGBB
+	IO_XBGR8888,	//32-bit words 0x00BBGGRR
+	IO_RGB565,	//16-bit words
+	IO_RGB888,	//packed, bytes B, G, R
+	IO_OTHER	//only io_* calls know how to write it
+};
+
+typedef struct {
+	int bpp;	//bytes per pixel
+	int rshift, gshift, bshift;	//position of the channels in a native pixel
+	enum io_layout layout;	//the shifts are of 8-bit channels for the 8888 ones
+} io_format_t;
+
+#define IO_DEPTH_TILE 8	//depth is kept in 8x8 tiles
+
+/*	z of tile (tx, ty) is z[(ty * tiles_x + tx) * IO_DEPTH_TILE^2 ...],
+	row after row inside the tile. zmin/zmax bound every z of a tile,
+	a "fresh" tile was cleared but its z wasn't written yet.	*/
+typedef struct {
+	float *z;
+	float *zmin, *zmax;
+	unsigned char *fresh;
+	int tiles_x, tiles_y;
+	float clear;
+} io_depth_t;
+
+typedef struct {
+	unsigned char *pixels;
+	int pitch;	//bytes per row
+	int width, height;
+	io_format_t format;
+	io_depth_t *depth;	//same size as the pixels, resized together
+} io_framebuffer_t;
+
+void io_LockFramebuffer(io_window_t *w, io_framebuffer_t *fb);
+void io_UnlockFramebuffer(io_window_t *w);	//fb is invalid after that
+
+/*	io_UpdateFrame shows only the regions written since the last one.
+	SetPixel, WriteSpan/Rect and Clear mark them on their own, a locked
+	framebuffer marks the whole window.	*/
+void io_MarkDirty(io_window_t *w, int x, int y, int width, int height);
+/*	The next frame overdraws the whole window: the next io_UpdateFrame
+	leaves the image drawing moves on to as it is instead of copying
+	the frame just shown into it. Holds for that one update only.	*/
+void io_DiscardFrame(io_window_t *w);
+void io_ClearDepth(io_window_t *w, float value);	//O(tiles), z is filled lazily
 void io_CloseWindow(io_window_t *w);
 
 /*------------------------------------------------- 
@@ -0,0 +1,359 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)io_memory.c	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+/*	Headless io.h backend: the window is a plain memory buffer.
+	Configured from the environment:
+	IO_MEMORY_SIZE=WxH	window size (DEFAULT_WINDOW_WIDTH x HEIGHT)
+	IO_MEMORY_DUMP=prefix	every io_UpdateFrame writes prefixNNNNNN.ppm
+	IO_MEMORY_DUMP_FORMAT=pam	write .pam instead of .ppm
+	IO_MEMORY_SCRIPT=file	scripted input, one event per line:
+		<frame> press <key>	key - io_keycode number
+		<frame> release <key>
+		<frame> move <x> <y>
+		<frame> resize <w> <h>
+		# comment
+	IO_MEMORY_STATS=1	print frame count and frame time at close
+	Events of frame N are delivered by io_PollKeys after the N-th
+	io_UpdateFrame (frame 0 - before the first one).	*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "io.h"
+
+/*------------------------------------------------- 
+	# Opaque Type implemetntation #
+------------------------------------------------- */
+
+enum st_io_event_type {EV_PRESS, EV_RELEASE, EV_MOVE, EV_RESIZE};
+
+typedef struct {
+	long frame;
+	enum st_io_event_type type;
+	int a, b;
+} st_io_event_t;
+
+struct io_window_inc_t {
+	int	io_w, io_h;
+	int	io_pitch;
+	unsigned char	*io_buf;
+	io_depth_t	io_depth;
+	long	io_frame;
+	st_io_event_t	*io_script;
+	int	io_nevents, io_next;
+	const char	*io_dump;
+	int	io_pam;
+	int	io_stats;
+	double	io_start;
+};
+
+/*------------------------------------------------- 
+	# 0.STATIC FUNC (internal usage only) #
+------------------------------------------------- */
+
+static double st_io_Now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void st_io_FreeDepth(io_depth_t *d) {
+	free(d->z);
+	free(d->zmin);
+	free(d->zmax);
+	free(d->fresh);
+	d->z = d->zmin = d->zmax = NULL;
+	d->fresh = NULL;
+}
+
+static void st_io_CreateDepth(io_depth_t *d, int width, int height) {
+	int tx = (width + IO_DEPTH_TILE - 1) / IO_DEPTH_TILE;
+	int ty = (height + IO_DEPTH_TILE - 1) / IO_DEPTH_TILE;
+	size_t tiles = (size_t)tx * ty;
+	d->tiles_x = tx;
+	d->tiles_y = ty;
+	d->z = aligned_alloc(64, tiles * IO_DEPTH_TILE * IO_DEPTH_TILE * sizeof(float));
+	d->zmin = malloc(tiles * sizeof(float));
+	d->zmax = malloc(tiles * sizeof(float));
+	d->fresh = malloc(tiles);
+	if (!d->z || !d->zmin || !d->zmax || !d->fresh) {
+		fprintf(stderr, "io_memory.c: Can't allocate depth buffer\n");
+		exit(1);
+	}
+	d->clear = 0.0f;
+	for (size_t i = 0; i < tiles; i++) {
+		d->zmin[i] = d->zmax[i] = d->clear;
+		d->fresh[i] = 1;
+	}
+}
+
+static void st_io_CreateFramebuffer(io_window_t *w, int width, int height) {
+	w->io_w = width;
+	w->io_h = height;
+	w->io_pitch = (width * 4 + 63) & ~63;	//rows start on a cache line
+	w->io_buf = aligned_alloc(64, (size_t)w->io_pitch * height);
+	if (!w->io_buf) {
+		fprintf(stderr, "io_memory.c: Can't allocate framebuffer\n");
+		exit(1);
+	}
+	memset(w->io_buf, 0, (size_t)w->io_pitch * height);
+	st_io_CreateDepth(&w->io_depth, width, height);
+}
+
+static void st_io_FreeFramebuffer(io_window_t *w) {
+	free(w->io_buf);
+	w->io_buf = NULL;
+	st_io_FreeDepth(&w->io_depth);
+}
+
+static void st_io_LoadScript(io_window_t *w, const char *path) {
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "io_memory.c: Can't open script %s\n", path);
+		exit(1);
+	}
+	char line[256], what[16];
+	int cap = 0, lineno = 0;
+	while (fgets(line, sizeof(line), f)) {
+		st_io_event_t e = {0};
+		lineno++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		int n = sscanf(line, "%ld %15s %d %d", &e.frame, what, &e.a, &e.b);
+		if (n >= 3 && !strcmp(what, "press")) e.type = EV_PRESS;
+		else if (n >= 3 && !strcmp(what, "release")) e.type = EV_RELEASE;
+		else if (n == 4 && !strcmp(what, "move")) e.type = EV_MOVE;
+		else if (n == 4 && !strcmp(what, "resize") && e.a > 0 && e.b > 0) e.type = EV_RESIZE;
+		else {
+			fprintf(stderr, "io_memory.c: %s:%i: bad event\n", path, lineno);
+			continue;
+		}
+		if (w->io_nevents == cap) {
+			cap = cap ? cap * 2 : 32;
+			w->io_script = realloc(w->io_script, sizeof(st_io_event_t) * cap);
+		}
+		w->io_script[w->io_nevents++] = e;
+	}
+	fclose(f);
+}
+
+static void st_io_DumpFrame(io_window_t *w) {
+	char path[4096];
+	snprintf(path, sizeof(path), "%s%06ld.%s", w->io_dump, w->io_frame, w->io_pam ? "pam" : "ppm");
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		perror("io_memory.c: dump");
+		return;
+	}
+	if (w->io_pam)
+		fprintf(f, "P7\nWIDTH %i\nHEIGHT %i\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n", w->io_w, w->io_h);
+	else
+		fprintf(f, "P6\n%i %i\n255\n", w->io_w, w->io_h);
+	unsigned char row[w->io_w * 3];
+	for (int y = 0; y < w->io_h; y++) {
+		const uint32_t *src = (const uint32_t *)(w->io_buf + (size_t)y * w->io_pitch);
+		for (int x = 0; x < w->io_w; x++) {
+			row[x * 3 + 0] = src[x] >> 16;
+			row[x * 3 + 1] = src[x] >> 8;
+			row[x * 3 + 2] = src[x];
+		}
+		fwrite(row, 1, sizeof(row), f);
+	}
+	fclose(f);
+}
+
+static void st_HandleKey(st_io_event_t *e, io_keys_t *c) {
+	int key = e->a;
+	if (key < 0 || key >= KEYCODE) return;
+	if (e->type == EV_PRESS) {
+		if (c->status[key] < IO_TOGGLED)
+			c->status[key] += IO_TOGGLED;
+		else
+			c->status[key] -= IO_TOGGLED;
+		c->status[key] += IO_HOLD;
+	}
+	else if (c->status[key] == IO_HOLD || c->status[key] == IO_HOLD_AND_TOGGLET) {
+		c->status[key] -= IO_HOLD;
+	}
+}
+
+/*------------------------------------------------- 
+	# 1.WINDOW INMPLEMENTATION #
+------------------------------------------------- */
+
+io_window_t *io_InitWindow(void) {
+	io_window_t *w = calloc(1, sizeof(io_window_t));
+	if (!w) return NULL;
+	int width = DEFAULT_WINDOW_WIDTH, height = DEFAULT_WINDOW_HEIGHT;
+	const char *env = getenv("IO_MEMORY_SIZE");
+	if (env && (sscanf(env, "%ix%i", &width, &height) != 2 || width <= 0 || height <= 0)) {
+		fprintf(stderr, "io_memory.c: Bad IO_MEMORY_SIZE %s\n", env);
+		width = DEFAULT_WINDOW_WIDTH;
+		height = DEFAULT_WINDOW_HEIGHT;
+	}
+	st_io_CreateFramebuffer(w, width, height);
+	w->io_dump = getenv("IO_MEMORY_DUMP");
+	env = getenv("IO_MEMORY_DUMP_FORMAT");
+	w->io_pam = env && !strcmp(env, "pam");
+	env = getenv("IO_MEMORY_STATS");
+	w->io_stats = env && *env && strcmp(env, "0");
+	if ((env = getenv("IO_MEMORY_SCRIPT")))
+		st_io_LoadScript(w, env);
+	w->io_start = st_io_Now();
+	return w;
+}
+
+void io_CloseWindow(io_window_t *w) {
+	if (!w) return;
+	if (w->io_stats) {
+		double t = st_io_Now() - w->io_start;
+		fprintf(stderr, "io_memory.c: %ld frames %ix%i, %.3f ms/frame, %.1f fps\n", w->io_frame,
+			w->io_w, w->io_h, w->io_frame ? t * 1e3 / w->io_frame : 0.0, w->io_frame ? w->io_frame / t : 0.0);
+	}
+	st_io_FreeFramebuffer(w);
+	free(w->io_script);
+	free(w);
+}
+
+void io_SetPixel(io_window_t *w, int x, int y, unsigned int color) {
+	if ((unsigned)x >= (unsigned)w->io_w || (unsigned)y >= (unsigned)w->io_h)
+		return;
+	*(uint32_t *)(w->io_buf + (size_t)y * w->io_pitch + x * 4) = color & 0xFFFFFF;
+}
+
+unsigned int io_GetPixel(io_window_t *w, int x, int y) {
+	if ((unsigned)x >= (unsigned)w->io_w || (unsigned)y >= (unsigned)w->io_h)
+		return 0;
+	return *(uint32_t *)(w->io_buf + (size_t)y * w->io_pitch + x * 4) & 0xFFFFFF;
+}
+
+void io_WriteSpan(io_window_t *w, int x, int y, const unsigned int *colors, int n) {
+	io_WriteRect(w, x, y, n, 1, colors, n);
+}
+
+void io_WriteRect(io_window_t *w, int x, int y, int width, int height,
+		const unsigned int *colors, int stride) {
+	if (x < 0) { colors -= x; width += x; x = 0; }
+	if (y < 0) { colors -= (long)y * stride; height += y; y = 0; }
+	if (x + width > w->io_w) width = w->io_w - x;
+	if (y + height > w->io_h) height = w->io_h - y;
+	if (width <= 0 || height <= 0)
+		return;
+	for (int j = 0; j < height; j++) {
+		uint32_t *dst = (uint32_t *)(w->io_buf + (size_t)(y + j) * w->io_pitch) + x;
+		const unsigned int *src = colors + (long)j * stride;
+		for (int i = 0; i < width; i++)
+			dst[i] = src[i] & 0xFFFFFF;
+	}
+}
+
+void io_Clear(io_window_t *w, unsigned int color) {
+	uint32_t pixel = color & 0xFFFFFF;
+	for (int y = 0; y < w->io_h; y++) {
+		uint32_t *row = (uint32_t *)(w->io_buf + (size_t)y * w->io_pitch);
+		for (int x = 0; x < w->io_w; x++)
+			row[x] = pixel;
+	}
+}
+
+void io_LockFramebuffer(io_window_t *w, io_framebuffer_t *fb) {
+	fb->pixels = w->io_buf;
+	fb->pitch = w->io_pitch;
+	fb->width = w->io_w;
+	fb->height = w->io_h;
+	fb->format.bpp = 4;
+	fb->format.rshift = 16;
+	fb->format.gshift = 8;
+	fb->format.bshift = 0;
+	fb->format.layout = IO_XRGB8888;
+	fb->depth = &w->io_depth;
+}
+
+void io_UnlockFramebuffer(io_window_t *w) {
+}
+
+void io_MarkDirty(io_window_t *w, int x, int y, int width, int height) {
+	//every frame is dumped whole
+}
+
+void io_DiscardFrame(io_window_t *w) {
+	//one image, nothing to bring up to date
+}
+
+void io_ClearDepth(io_window_t *w, float value) {
+	io_depth_t *d = &w->io_depth;
+	size_t tiles = (size_t)d->tiles_x * d->tiles_y;
+	d->clear = value;
+	for (size_t i = 0; i < tiles; i++)
+		d->zmin[i] = d->zmax[i] = value;
+	memset(d->fresh, 1, tiles);
+}
+
+void io_UpdateFrame(io_window_t *w) {
+	w->io_frame++;
+	if (w->io_dump)
+		st_io_DumpFrame(w);
+}
+
+int io_SetPresentBuffers(io_window_t *w, int n) {
+	return 1;	//frames are dumped synchronously
+}
+
+int io_GetWidth(io_window_t *w){
+	return w->io_w;
+}
+
+int io_GetHeight(io_window_t *w){
+	return w->io_h;
+}
+
+/*------------------------------------------------- 
+	# 2.KEYBOARD AND MOUSE INMPLEMENTATION #
+------------------------------------------------- */
+
+io_keys_t *io_InitKeys(void){
+	io_keys_t *c = malloc(sizeof(io_keys_t));
+	for(int i = 0; i < KEYCODE; i++){
+		c->status[i] = IO_NONE;
+	};
+	c->x = 0; c->y = 0;
+	return c;
+}
+
+/*	Delivers the script events that are due. BLOCK_POLL jumps to the
+	next event when nothing is due yet instead of waiting forever. */
+void io_PollKeys(io_window_t *w, io_keys_t *c, int mode) {
+	if (mode == BLOCK_POLL && w->io_next < w->io_nevents &&
+			w->io_script[w->io_next].frame > w->io_frame)
+		w->io_frame = w->io_script[w->io_next].frame;
+	while (w->io_next < w->io_nevents && w->io_script[w->io_next].frame <= w->io_frame) {
+		st_io_event_t *e = &w->io_script[w->io_next++];
+		switch (e->type) {
+		case EV_PRESS:
+		case EV_RELEASE:
+			st_HandleKey(e, c);
+			break;
+		case EV_MOVE:
+			c->x = e->a;
+			c->y = e->b;
+			break;
+		case EV_RESIZE:
+			if (e->a == w->io_w && e->b == w->io_h) break;
+			st_io_FreeFramebuffer(w);
+			st_io_CreateFramebuffer(w, e->a, e->b);
+			break;
+		}
+	}
+}
+
+void io_FreeKeys(io_keys_t *c){
+	if (c == NULL) return;
+	free(c);
+}
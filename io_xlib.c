@@ -7,13 +7,42 @@
 #include <X11/keysym.h>
 #include <X11/XKBlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "io.h"
 
 /*------------------------------------------------- 
 	# Opaque Type implemetntation #
 ------------------------------------------------- */
 
+typedef struct {
+	int bpp, swap;	//swap - image byte order isn't the host one
+	int shift[3], bits[3];	//r, g, b
+} st_io_layout_t;
+
+typedef struct {
+	void (*Span)(const st_io_layout_t *l, unsigned char *dst, const unsigned int *src, int n);
+	void (*Fill)(const st_io_layout_t *l, unsigned char *dst, unsigned int color, int n);
+	unsigned int (*Load)(const st_io_layout_t *l, const unsigned char *p);
+} st_io_kernels_t;
+
+#define PRESENT_MAX 3	//XShm images a window rotates through
+#define SHM_HEADROOM 2	//a new segment is 1 + 1/SHM_HEADROOM of the image
+#define SHM_SHRINK 4	//an image under 1/SHM_SHRINK of its segment gets a new one
+
+/*	Presented images stay busy till the server reports every put
+	of them done. stale - tiles shown since the image was drawn
+	last, copied in from the newest frame when it becomes current. */
+typedef struct {
+	XImage	*img;
+	XShmSegmentInfo	shm;
+	size_t	cap;	//bytes of the segment, 0 - none
+	int	busy;	//puts without a ShmCompletion yet
+	uint64_t	*stale;	//io_dirty layout
+	int	stale_all;
+} st_io_buffer_t;
+
 struct io_window_inc_t {
 	Display	*x_dpy;
 	int	x_scr;
@@ -21,11 +50,27 @@ struct io_window_inc_t {
 	GC	x_gc;
 	Atom	x_wm_delete;
 	int	io_w, io_h;
-	XImage	*x_img;
-	XShmSegmentInfo	x_shm;
+	st_io_buffer_t	x_bufs[PRESENT_MAX];
+	int	x_nbufs, x_cur;	//x_cur - the one being drawn
+	int	x_completion;	//ShmCompletion event type
+	XImage	*x_img;	//x_bufs[x_cur].img
 	unsigned char	*io_buf;
+	io_format_t	io_fmt;
+	st_io_layout_t	io_lay;
+	const st_io_kernels_t	*io_k;	//st_io_Kernels[io_fmt.layout]
+	io_depth_t	io_depth;
+	size_t	io_depth_cap;	//tiles allocated
+	uint64_t	*io_dirty;	//bit per DIRTY_TILE tile, io_dirty_words per tile row
+	int	io_dirty_words;
+	int	io_dirty_all;
+	int	io_discard;	//next frame is drawn whole, see io_DiscardFrame
 };
 
+#define DIRTY_SHIFT 5
+#define DIRTY_TILE (1 << DIRTY_SHIFT)	//pixels
+#define DIRTY_RECTS 32	//more coalesced rects than that - one full put
+#define DIRTY_FULL 2	//1/DIRTY_FULL of tiles dirty - one full put
+
 /*------------------------------------------------- 
 	# 0.STATIC FUNC (internal usage only) #
 ------------------------------------------------- */
@@ -97,27 +142,421 @@ static GC st_io_CreateGC(Display *dpy, Window win) {
 	return XCreateGC(dpy, win, 0, NULL);
 }
 
-static XImage *st_io_CreateFramebuffer(Display *dpy, int screen, int width, int height, XShmSegmentInfo *shm_info) {
-	if (!XShmQueryExtension(dpy)) {
-		fprintf(stderr, "io_xlib.c: XShm not supported\n");
-		exit(1);
+/*	Every visual layout has its own row kernels, picked once per
+	image. Layouts without one go through the generic kernels, which
+	follow the masks and the image byte order.	*/
+
+static void st_io_SpanXRGB(const st_io_layout_t *l, unsigned char *dst, const unsigned int *src, int n) {
+	uint32_t *d = (uint32_t *)dst;
+	for (int i = 0; i < n; i++)
+		d[i] = src[i] & 0xFFFFFF;
+}
+
+static void st_io_FillXRGB(const st_io_layout_t *l, unsigned char *dst, unsigned int color, int n) {
+	uint32_t *d = (uint32_t *)dst, pixel = color & 0xFFFFFF;
+	for (int i = 0; i < n; i++)
+		d[i] = pixel;
+}
+
+static unsigned int st_io_LoadXRGB(const st_io_layout_t *l, const unsigned char *p) {
+	return *(const uint32_t *)p & 0xFFFFFF;
+}
+
+static inline uint32_t st_io_BGR(unsigned int c) {
+	return (c & 0xFF00) | (c >> 16 & 0xFF) | (c & 0xFF) << 16;
+}
+
+static void st_io_SpanXBGR(const st_io_layout_t *l, unsigned char *dst, const unsigned int *src, int n) {
+	uint32_t *d = (uint32_t *)dst;
+	for (int i = 0; i < n; i++)
+		d[i] = st_io_BGR(src[i]);
+}
+
+static void st_io_FillXBGR(const st_io_layout_t *l, unsigned char *dst, unsigned int color, int n) {
+	st_io_FillXRGB(l, dst, st_io_BGR(color), n);
+}
+
+static unsigned int st_io_LoadXBGR(const st_io_layout_t *l, const unsigned char *p) {
+	return st_io_BGR(*(const uint32_t *)p);
+}
+
+static inline uint16_t st_io_565(unsigned int c) {
+	return (c >> 8 & 0xF800) | (c >> 5 & 0x7E0) | (c >> 3 & 0x1F);
+}
+
+static void st_io_Span565(const st_io_layout_t *l, unsigned char *dst, const unsigned int *src, int n) {
+	uint16_t *d = (uint16_t *)dst;
+	for (int i = 0; i < n; i++)
+		d[i] = st_io_565(src[i]);
+}
+
+static void st_io_Fill565(const st_io_layout_t *l, unsigned char *dst, unsigned int color, int n) {
+	uint16_t *d = (uint16_t *)dst, pixel = st_io_565(color);
+	for (int i = 0; i < n; i++)
+		d[i] = pixel;
+}
+
+static unsigned int st_io_Load565(const st_io_layout_t *l, const unsigned char *p) {
+	unsigned int v = *(const uint16_t *)p;
+	unsigned int r = v >> 11, g = v >> 5 & 0x3F, b = v & 0x1F;
+	return (r << 3 | r >> 2) << 16 | (g << 2 | g >> 4) << 8 | (b << 3 | b >> 2);
+}
+
+//packed 24bpp, 0xRRGGBB masks, LSB first: B, G, R in memory
+static void st_io_SpanRGB888(const st_io_layout_t *l, unsigned char *dst, const unsigned int *src, int n) {
+	for (int i = 0; i < n; i++, dst += 3) {
+		dst[0] = src[i];
+		dst[1] = src[i] >> 8;
+		dst[2] = src[i] >> 16;
 	}
-	XImage *ximg = XShmCreateImage(dpy,
-		DefaultVisual(dpy, screen),
-		DefaultDepth(dpy, screen),
-		ZPixmap, NULL, shm_info, width, height);
-	shm_info->shmid = shmget(IPC_PRIVATE, ximg->bytes_per_line * ximg->height,
-		IPC_CREAT | 0777);
-	shm_info->shmaddr = ximg->data = shmat(shm_info->shmid, 0, 0);
-	shm_info->readOnly = False;
-	if (shm_info->shmaddr == (void *)-1) {
-		perror("io_xlib.c: shmat");
-		exit(1);
+}
+
+static void st_io_FillRGB888(const st_io_layout_t *l, unsigned char *dst, unsigned int color, int n) {
+	for (int i = 0; i < n; i++, dst += 3) {
+		dst[0] = color;
+		dst[1] = color >> 8;
+		dst[2] = color >> 16;
+	}
+}
+
+static unsigned int st_io_LoadRGB888(const st_io_layout_t *l, const unsigned char *p) {
+	return p[2] << 16 | p[1] << 8 | p[0];
+}
+
+static uint32_t st_io_Pack(const st_io_layout_t *l, unsigned int color) {
+	uint32_t v = 0;
+	for (int i = 0; i < 3; i++) {
+		uint32_t c = color >> (16 - 8 * i) & 0xFF;
+		c = l->bits[i] < 8 ? c >> (8 - l->bits[i]) : c << (l->bits[i] - 8);
+		v |= c << l->shift[i];
+	}
+	return v;
+}
+
+static void st_io_SpanGeneric(const st_io_layout_t *l, unsigned char *dst, const unsigned int *src, int n) {
+	for (int i = 0; i < n; i++, dst += l->bpp) {
+		uint32_t v = st_io_Pack(l, src[i]);
+		for (int k = 0; k < l->bpp; k++)
+			dst[l->swap ? l->bpp - 1 - k : k] = v >> (8 * k);
+	}
+}
+
+static void st_io_FillGeneric(const st_io_layout_t *l, unsigned char *dst, unsigned int color, int n) {
+	for (int i = 0; i < n; i++, dst += l->bpp)
+		st_io_SpanGeneric(l, dst, &color, 1);
+}
+
+static unsigned int st_io_LoadGeneric(const st_io_layout_t *l, const unsigned char *p) {
+	uint32_t v = 0;
+	unsigned int color = 0;
+	for (int k = 0; k < l->bpp; k++)
+		v |= (uint32_t)p[l->swap ? l->bpp - 1 - k : k] << (8 * k);
+	for (int i = 0; i < 3; i++) {
+		int bits = l->bits[i];
+		uint32_t c = v >> l->shift[i] & ((1u << bits) - 1);
+		if (bits >= 8) {
+			c >>= bits - 8;
+		} else if (bits > 0) {	//replicate the top bits into the low ones
+			c <<= 8 - bits;
+			for (int k = bits; k < 8; k *= 2)
+				c |= c >> k;
+		}
+		color |= c << (16 - 8 * i);
+	}
+	return color;
+}
+
+static const st_io_kernels_t st_io_Kernels[] = {
+	[IO_XRGB8888] = {st_io_SpanXRGB, st_io_FillXRGB, st_io_LoadXRGB},
+	[IO_XBGR8888] = {st_io_SpanXBGR, st_io_FillXBGR, st_io_LoadXBGR},
+	[IO_RGB565] = {st_io_Span565, st_io_Fill565, st_io_Load565},
+	[IO_RGB888] = {st_io_SpanRGB888, st_io_FillRGB888, st_io_LoadRGB888},
+	[IO_OTHER] = {st_io_SpanGeneric, st_io_FillGeneric, st_io_LoadGeneric}
+};
+
+static int st_io_HostMSB(void) {
+	const uint16_t one = 1;
+	return *(const unsigned char *)&one == 0;
+}
+
+static void st_io_Format(XImage *ximg, io_format_t *f, st_io_layout_t *l) {
+	unsigned long mask[3] = {ximg->red_mask, ximg->green_mask, ximg->blue_mask};
+	l->bpp = f->bpp = ximg->bits_per_pixel / 8;
+	l->swap = (ximg->byte_order == MSBFirst) != st_io_HostMSB();
+	for (int i = 0; i < 3; i++) {
+		l->shift[i] = __builtin_ctzl(mask[i]);
+		l->bits[i] = __builtin_popcountl(mask[i]);
+	}
+	f->rshift = l->shift[0];
+	f->gshift = l->shift[1];
+	f->bshift = l->shift[2];
+	f->layout = IO_OTHER;
+	if (l->bits[0] == 8 && l->bits[1] == 8 && l->bits[2] == 8 && l->shift[1] == 8 && !l->swap) {
+		if (f->bpp == 4 && l->shift[0] == 16 && l->shift[2] == 0) f->layout = IO_XRGB8888;
+		if (f->bpp == 4 && l->shift[0] == 0 && l->shift[2] == 16) f->layout = IO_XBGR8888;
+		if (f->bpp == 3 && l->shift[0] == 16 && l->shift[2] == 0) f->layout = IO_RGB888;
 	}
-	XShmAttach(dpy, shm_info);
+	if (f->bpp == 2 && !l->swap && mask[0] == 0xF800 && mask[1] == 0x7E0 && mask[2] == 0x1F)
+		f->layout = IO_RGB565;
+	#ifdef DEBUG
+	printf("(dbg) io_xlib.c: %i bpp visual, layout %i\n", f->bpp * 8, f->layout);
+	#endif
+}
+
+static void st_io_FreeDepth(io_depth_t *d) {
+	free(d->z);
+	free(d->zmin);
+	free(d->zmax);
+	free(d->fresh);
+	d->z = d->zmin = d->zmax = NULL;
+	d->fresh = NULL;
+}
+
+/*	Keeps the arrays while the tiles fit, *cap - tiles allocated */
+static void st_io_CreateDepth(io_depth_t *d, size_t *cap, int width, int height) {
+	int tx = (width + IO_DEPTH_TILE - 1) / IO_DEPTH_TILE;
+	int ty = (height + IO_DEPTH_TILE - 1) / IO_DEPTH_TILE;
+	size_t tiles = (size_t)tx * ty;
+	d->tiles_x = tx;
+	d->tiles_y = ty;
+	if (tiles > *cap) {
+		st_io_FreeDepth(d);
+		*cap = tiles + tiles / SHM_HEADROOM;
+		d->z = aligned_alloc(64, *cap * IO_DEPTH_TILE * IO_DEPTH_TILE * sizeof(float));
+		d->zmin = malloc(*cap * sizeof(float));
+		d->zmax = malloc(*cap * sizeof(float));
+		d->fresh = malloc(*cap);
+		if (!d->z || !d->zmin || !d->zmax || !d->fresh) {
+			fprintf(stderr, "io_xlib.c: Can't allocate depth buffer\n");
+			exit(1);
+		}
+	}
+	d->clear = 0.0f;
+	for (size_t i = 0; i < tiles; i++) {
+		d->zmin[i] = d->zmax[i] = d->clear;
+		d->fresh[i] = 1;
+	}
+}
+
+static void st_io_FreeSegment(Display *dpy, st_io_buffer_t *b) {
+	XShmDetach(dpy, &b->shm);
+	shmdt(b->shm.shmaddr);
+	shmctl(b->shm.shmid, IPC_RMID, NULL);
+	b->cap = 0;
+}
+
+/*	The image header is client side only. The segment under it is
+	kept while the image fits and isn't much smaller, otherwise it
+	is replaced by one with headroom for the next growth.	*/
+static XImage *st_io_CreateImage(io_window_t *w, st_io_buffer_t *b, int width, int height) {
+	XImage *ximg = XShmCreateImage(w->x_dpy,
+		DefaultVisual(w->x_dpy, w->x_scr),
+		DefaultDepth(w->x_dpy, w->x_scr),
+		ZPixmap, NULL, &b->shm, width, height);
+	size_t need = (size_t)ximg->bytes_per_line * ximg->height;
+	if (b->cap && (need > b->cap || need * SHM_SHRINK < b->cap))
+		st_io_FreeSegment(w->x_dpy, b);
+	if (!b->cap) {
+		b->cap = need + need / SHM_HEADROOM;
+		b->shm.shmid = shmget(IPC_PRIVATE, b->cap, IPC_CREAT | 0777);
+		b->shm.shmaddr = shmat(b->shm.shmid, 0, 0);
+		b->shm.readOnly = False;
+		if (b->shm.shmaddr == (void *)-1) {
+			perror("io_xlib.c: shmat");
+			exit(1);
+		}
+		XShmAttach(w->x_dpy, &b->shm);
+		#ifdef DEBUG
+		printf("(dbg) io_xlib.c: new %zu byte segment for %ix%i\n", b->cap, width, height);
+		#endif
+	}
+	else
+		memset(b->shm.shmaddr, 0, need);	//blank like a fresh segment
+	ximg->data = b->shm.shmaddr;
 	return ximg;
 }
 
+static void st_io_CreateDirty(io_window_t *w) {
+	int tx = (w->io_w + DIRTY_TILE - 1) >> DIRTY_SHIFT;
+	int ty = (w->io_h + DIRTY_TILE - 1) >> DIRTY_SHIFT;
+	free(w->io_dirty);
+	w->io_dirty_words = (tx + 63) / 64;
+	w->io_dirty = calloc((size_t)w->io_dirty_words * ty, sizeof(uint64_t));
+	if (!w->io_dirty) {
+		fprintf(stderr, "io_xlib.c: Can't allocate dirty mask\n");
+		exit(1);
+	}
+	w->io_dirty_all = 1;	//new image, nothing is on the screen yet
+	for (int i = 0; i < w->x_nbufs; i++) {
+		st_io_buffer_t *b = &w->x_bufs[i];
+		free(b->stale);
+		b->stale = calloc((size_t)w->io_dirty_words * ty, sizeof(uint64_t));
+		if (!b->stale) {
+			fprintf(stderr, "io_xlib.c: Can't allocate dirty mask\n");
+			exit(1);
+		}
+		b->stale_all = (i != w->x_cur);
+	}
+}
+
+static void st_io_UseBuffer(io_window_t *w, int i) {
+	w->x_cur = i;
+	w->x_img = w->x_bufs[i].img;
+	w->io_buf = (unsigned char *)w->x_img->data;
+}
+
+static void st_io_CreateBuffers(io_window_t *w, int n) {
+	for (int i = 0; i < n; i++)
+		w->x_bufs[i].img = st_io_CreateImage(w, &w->x_bufs[i], w->io_w, w->io_h);
+	w->x_nbufs = n;
+	st_io_UseBuffer(w, 0);
+	st_io_Format(w->x_img, &w->io_fmt, &w->io_lay);
+	w->io_k = &st_io_Kernels[w->io_fmt.layout];
+}
+
+static void st_io_FreeBuffers(io_window_t *w) {
+	XEvent e;
+	XSync(w->x_dpy, False);	//every put is done, its completion is queued
+	while (XCheckTypedEvent(w->x_dpy, w->x_completion, &e))
+		;
+	for (int i = 0; i < w->x_nbufs; i++) {
+		st_io_buffer_t *b = &w->x_bufs[i];
+		XDestroyImage(b->img);	//the header, the segment is ours
+		st_io_FreeSegment(w->x_dpy, b);
+		free(b->stale);
+		memset(b, 0, sizeof(st_io_buffer_t));
+	}
+	w->x_nbufs = 0;
+	w->x_img = NULL;
+	w->io_buf = NULL;
+}
+
+static inline void st_io_MarkTile(io_window_t *w, int x, int y) {
+	int tx = x >> DIRTY_SHIFT;
+	w->io_dirty[(y >> DIRTY_SHIFT) * w->io_dirty_words + (tx >> 6)] |= 1ull << (tx & 63);
+}
+
+//x, y, width, height are clipped by the caller
+static void st_io_MarkRect(io_window_t *w, int x, int y, int width, int height) {
+	int tx0 = x >> DIRTY_SHIFT, tx1 = (x + width - 1) >> DIRTY_SHIFT;
+	int ty0 = y >> DIRTY_SHIFT, ty1 = (y + height - 1) >> DIRTY_SHIFT;
+	for (int ty = ty0; ty <= ty1; ty++) {
+		uint64_t *row = w->io_dirty + (size_t)ty * w->io_dirty_words;
+		for (int tx = tx0; tx <= tx1; tx++)
+			row[tx >> 6] |= 1ull << (tx & 63);
+	}
+}
+
+static void st_io_Put(io_window_t *w, int x, int y, int width, int height) {
+	int async = w->x_nbufs > 1;	//a single image gets no completion to wait for
+	XShmPutImage(w->x_dpy, w->x_win, w->x_gc, w->x_img, x, y, x, y, width, height, async);
+	w->x_bufs[w->x_cur].busy += async;
+}
+
+/*	Runs of dirty tiles in a tile row become spans, a span that
+	repeats the one right above extends its rect downwards.	*/
+static void st_io_PutDirty(io_window_t *w) {
+	typedef struct {int x0, x1, y0, y1;} rect_t;
+	int tx = (w->io_w + DIRTY_TILE - 1) >> DIRTY_SHIFT;
+	int ty = (w->io_h + DIRTY_TILE - 1) >> DIRTY_SHIFT;
+	rect_t done[DIRTY_RECTS], open[DIRTY_RECTS], next[DIRTY_RECTS];
+	int ndone = 0, nopen = 0, tiles = 0;
+	for (int y = 0; y <= ty; y++) {
+		int nnext = 0, x = 0, o = 0;
+		const uint64_t *row = w->io_dirty + (size_t)y * w->io_dirty_words;
+		while (y < ty && x < tx) {
+			if (!(row[x >> 6] >> (x & 63) & 1)) { x++; continue; }
+			int x0 = x;
+			while (x < tx && (row[x >> 6] >> (x & 63) & 1))
+				x++;
+			tiles += x - x0;
+			while (o < nopen && open[o].x0 < x0)	//rects ending above
+				done[ndone++] = open[o++];
+			if (o < nopen && open[o].x0 == x0 && open[o].x1 == x) {
+				next[nnext] = open[o++];
+				next[nnext++].y1 = y + 1;
+				continue;
+			}
+			if (ndone + nnext + nopen - o == DIRTY_RECTS) {
+				w->io_dirty_all = 1;
+				return;
+			}
+			next[nnext++] = (rect_t){x0, x, y, y + 1};
+		}
+		while (o < nopen)
+			done[ndone++] = open[o++];
+		memcpy(open, next, sizeof(rect_t) * nnext);
+		nopen = nnext;
+	}
+	if (tiles * DIRTY_FULL >= tx * ty) {
+		w->io_dirty_all = 1;
+		return;
+	}
+	for (int i = 0; i < ndone; i++) {
+		int x = done[i].x0 << DIRTY_SHIFT, y = done[i].y0 << DIRTY_SHIFT;
+		int x1 = done[i].x1 << DIRTY_SHIFT, y1 = done[i].y1 << DIRTY_SHIFT;
+		st_io_Put(w, x, y, (x1 < w->io_w ? x1 : w->io_w) - x, (y1 < w->io_h ? y1 : w->io_h) - y);
+	}
+	#ifdef DEBUG
+	printf("(dbg) io_xlib.c: %i dirty tiles in %i rects\n", tiles, ndone);
+	#endif
+}
+
+/*	What this frame changed is stale in every other image */
+static void st_io_MarkStale(io_window_t *w) {
+	int ty = (w->io_h + DIRTY_TILE - 1) >> DIRTY_SHIFT;
+	size_t words = (size_t)w->io_dirty_words * ty;
+	for (int i = 0; i < w->x_nbufs; i++) {
+		st_io_buffer_t *b = &w->x_bufs[i];
+		if (i == w->x_cur || b->stale_all)
+			continue;
+		if (w->io_dirty_all) {
+			b->stale_all = 1;
+			continue;
+		}
+		for (size_t k = 0; k < words; k++)
+			b->stale[k] |= w->io_dirty[k];
+	}
+}
+
+static void st_io_ClearStale(io_window_t *w, int i) {
+	int ty = (w->io_h + DIRTY_TILE - 1) >> DIRTY_SHIFT;
+	w->x_bufs[i].stale_all = 0;
+	memset(w->x_bufs[i].stale, 0, sizeof(uint64_t) * w->io_dirty_words * ty);
+}
+
+/*	Copies the stale tiles of image "to" from image "from" (the newest
+	frame), a run of tiles in a tile row goes as one span per row.	*/
+static void st_io_CopyStale(io_window_t *w, int from, int to) {
+	st_io_buffer_t *src = &w->x_bufs[from], *dst = &w->x_bufs[to];
+	int pitch = w->x_img->bytes_per_line, bpp = w->io_fmt.bpp;
+	int tx = (w->io_w + DIRTY_TILE - 1) >> DIRTY_SHIFT;
+	int ty = (w->io_h + DIRTY_TILE - 1) >> DIRTY_SHIFT;
+	if (dst->stale_all) {
+		memcpy(dst->img->data, src->img->data, (size_t)pitch * w->io_h);
+		st_io_ClearStale(w, to);
+		return;
+	}
+	for (int y = 0; y < ty; y++) {
+		uint64_t *row = dst->stale + (size_t)y * w->io_dirty_words;
+		int y0 = y << DIRTY_SHIFT, y1 = (y + 1) << DIRTY_SHIFT;
+		if (y1 > w->io_h)
+			y1 = w->io_h;
+		for (int x = 0; x < tx; ) {
+			if (!(row[x >> 6] >> (x & 63) & 1)) { x++; continue; }
+			int x0 = x;
+			while (x < tx && (row[x >> 6] >> (x & 63) & 1))
+				x++;
+			size_t from_byte = (size_t)(x0 << DIRTY_SHIFT) * bpp;
+			size_t bytes = (size_t)((x << DIRTY_SHIFT) < w->io_w ? x << DIRTY_SHIFT : w->io_w) * bpp - from_byte;
+			for (int j = y0; j < y1; j++)
+				memcpy(dst->img->data + (size_t)j * pitch + from_byte,
+					src->img->data + (size_t)j * pitch + from_byte, bytes);
+		}
+		memset(row, 0, sizeof(uint64_t) * w->io_dirty_words);
+	}
+}
+
 typedef void (*st_io_EventHandler_t)(XEvent *e, io_keys_t *c, io_window_t *w);
 
 static void st_HandleKey(XEvent *e, io_keys_t *c, io_window_t *w) {
@@ -155,17 +594,50 @@ static void st_HandleMotion(XEvent *e, io_keys_t *c, io_window_t *w) {
 	c->y = e->xmotion.y;
 }
 
+static void st_HandleCompletion(XEvent *e, io_keys_t *c, io_window_t *w) {
+	XShmCompletionEvent *ce = (XShmCompletionEvent *)e;
+	for (int i = 0; i < w->x_nbufs; i++)
+		if (w->x_bufs[i].shm.shmseg == ce->shmseg && w->x_bufs[i].busy > 0)
+			w->x_bufs[i].busy--;
+}
+
+static Bool st_io_IsCompletion(Display *dpy, XEvent *e, XPointer type) {
+	return e->type == *(int *)type;
+}
+
+/*	Takes only completions off the queue, input stays for io_PollKeys */
+static void st_io_WaitBuffer(io_window_t *w, int i) {
+	XEvent e;
+	while (w->x_bufs[i].busy > 0) {
+		XIfEvent(w->x_dpy, &e, st_io_IsCompletion, (XPointer)&w->x_completion);
+		st_HandleCompletion(&e, NULL, w);
+	}
+}
+
+/*	Only the last ConfigureNotify already queued is applied. Images
+	are rebuilt over their segments once the server is done with them. */
 static void st_HandleConfigure(XEvent *e, io_keys_t *c, io_window_t *w) {
+	XEvent last;
+	while (XCheckTypedWindowEvent(w->x_dpy, w->x_win, ConfigureNotify, &last))
+		e = &last;
 	XConfigureEvent *ce = &e->xconfigure;
 	if (ce->width == w->io_w && ce->height == w->io_h) return;
 	w->io_w = ce->width;
 	w->io_h = ce->height;
-	XShmDetach(w->x_dpy, &w->x_shm);
-	XDestroyImage(w->x_img);
-	shmdt(w->x_shm.shmaddr);
-	shmctl(w->x_shm.shmid, IPC_RMID, NULL);
-	w->x_img = st_io_CreateFramebuffer(w->x_dpy, w->x_scr, w->io_w, w->io_h, &w->x_shm);
-	w->io_buf = (unsigned char *)w->x_img->data;
+	for (int i = 0; i < w->x_nbufs; i++) {
+		st_io_buffer_t *b = &w->x_bufs[i];
+		st_io_WaitBuffer(w, i);
+		XDestroyImage(b->img);
+		b->img = st_io_CreateImage(w, b, w->io_w, w->io_h);
+	}
+	st_io_UseBuffer(w, w->x_cur);
+	st_io_CreateDepth(&w->io_depth, &w->io_depth_cap, w->io_w, w->io_h);
+	st_io_CreateDirty(w);
+}
+
+static void st_HandleExpose(XEvent *e, io_keys_t *c, io_window_t *w) {
+	XExposeEvent *ee = &e->xexpose;
+	io_MarkDirty(w, ee->x, ee->y, ee->width, ee->height);
 }
 
 static void st_HandleClose(XEvent *e, io_keys_t *c, io_window_t *w) {
@@ -198,6 +670,7 @@ static st_io_EventHandler_t st_EventHandlers[LASTEvent] = {
 	[ButtonRelease]   = st_HandleMouse,
 	[MotionNotify]    = st_HandleMotion,
 	[ConfigureNotify] = st_HandleConfigure,
+	[Expose]          = st_HandleExpose,
 	[ClientMessage]   = st_HandleClose,
 	[FocusIn]         = st_HandleFocus,
 	[FocusOut]        = st_HandleFocus
@@ -216,47 +689,153 @@ io_window_t *io_InitWindow(void) {
 	w->x_scr = DefaultScreen(w->x_dpy);
 	w->x_win = st_io_CreateWindow(w->x_dpy, w->x_scr, w->io_w, w->io_h, &w->x_wm_delete);
 	w->x_gc = st_io_CreateGC(w->x_dpy, w->x_win);
-	w->x_img = st_io_CreateFramebuffer(w->x_dpy, w->x_scr, w->io_w, w->io_h, &w->x_shm);
-	w->io_buf = (unsigned char *)w->x_img->data;
+	if (!XShmQueryExtension(w->x_dpy)) {
+		fprintf(stderr, "io_xlib.c: XShm not supported\n");
+		exit(1);
+	}
+	w->x_completion = XShmGetEventBase(w->x_dpy) + ShmCompletion;
+	st_io_CreateBuffers(w, DEFAULT_PRESENT_BUFFERS);
+	st_io_CreateDepth(&w->io_depth, &w->io_depth_cap, w->io_w, w->io_h);
+	st_io_CreateDirty(w);
 	return w;
 }
 
 void io_CloseWindow(io_window_t *w) {
 	if (!w) return;
 	st_io_EnableKeyRepeat(w->x_dpy);
-	XShmDetach(w->x_dpy, &w->x_shm);
-	XDestroyImage(w->x_img);
-	shmdt(w->x_shm.shmaddr);
-	shmctl(w->x_shm.shmid, IPC_RMID, NULL);
+	st_io_FreeBuffers(w);
 	XFreeGC(w->x_dpy, w->x_gc);
 	XDestroyWindow(w->x_dpy, w->x_win);
 	XCloseDisplay(w->x_dpy);
+	st_io_FreeDepth(&w->io_depth);
+	free(w->io_dirty);
 	free(w);
 }
 
 void io_SetPixel(io_window_t *w, int x, int y, unsigned int color) {
 	if ((unsigned)x >= (unsigned)w->io_w || (unsigned)y >= (unsigned)w->io_h)
 		return;
-	uint32_t pixel = 0;
-	pixel |= ((color >> 16) & 0xFF) << __builtin_ctz(w->x_img->red_mask);
-	pixel |= ((color >> 8) & 0xFF) << __builtin_ctz(w->x_img->green_mask);
-	pixel |= (color & 0xFF) << __builtin_ctz(w->x_img->blue_mask);
-	*(uint32_t *)(w->x_img->data + y * w->x_img->bytes_per_line + x * 4) = pixel;
+	unsigned char *p = w->io_buf + (size_t)y * w->x_img->bytes_per_line + x * w->io_fmt.bpp;
+	if (w->io_fmt.layout == IO_XRGB8888)
+		*(uint32_t *)p = color & 0xFFFFFF;
+	else
+		w->io_k->Fill(&w->io_lay, p, color, 1);
+	st_io_MarkTile(w, x, y);
 }
 
 unsigned int io_GetPixel(io_window_t *w, int x, int y) {
 	if ((unsigned)x >= (unsigned)w->io_w || (unsigned)y >= (unsigned)w->io_h)
 		return 0;
-	uint32_t pixel = *(uint32_t *)(w->x_img->data + y * w->x_img->bytes_per_line + x * 4);
-	unsigned int r = ((pixel & w->x_img->red_mask)   >> __builtin_ctz(w->x_img->red_mask));
-	unsigned int g = ((pixel & w->x_img->green_mask) >> __builtin_ctz(w->x_img->green_mask));
-	unsigned int b = ((pixel & w->x_img->blue_mask)  >> __builtin_ctz(w->x_img->blue_mask));
-	return (r << 16) | (g << 8) | b;
+	const unsigned char *p = w->io_buf + (size_t)y * w->x_img->bytes_per_line + x * w->io_fmt.bpp;
+	if (w->io_fmt.layout == IO_XRGB8888)
+		return *(const uint32_t *)p & 0xFFFFFF;
+	return w->io_k->Load(&w->io_lay, p);
+}
+
+void io_WriteSpan(io_window_t *w, int x, int y, const unsigned int *colors, int n) {
+	io_WriteRect(w, x, y, n, 1, colors, n);
 }
 
+void io_WriteRect(io_window_t *w, int x, int y, int width, int height,
+		const unsigned int *colors, int stride) {
+	if (x < 0) { colors -= x; width += x; x = 0; }
+	if (y < 0) { colors -= (long)y * stride; height += y; y = 0; }
+	if (x + width > w->io_w) width = w->io_w - x;
+	if (y + height > w->io_h) height = w->io_h - y;
+	if (width <= 0 || height <= 0)
+		return;
+	int pitch = w->x_img->bytes_per_line;
+	unsigned char *row = w->io_buf + (size_t)y * pitch + x * w->io_fmt.bpp;
+	for (int j = 0; j < height; j++, row += pitch)
+		w->io_k->Span(&w->io_lay, row, colors + (long)j * stride, width);
+	st_io_MarkRect(w, x, y, width, height);
+}
+
+/*	The first row goes through the kernel, the rest are copies of it */
+void io_Clear(io_window_t *w, unsigned int color) {
+	int pitch = w->x_img->bytes_per_line;
+	size_t bytes = (size_t)w->io_w * w->io_fmt.bpp;
+	w->io_dirty_all = 1;
+	w->io_k->Fill(&w->io_lay, w->io_buf, color, w->io_w);
+	if (memcmp(w->io_buf, w->io_buf + 1, bytes - 1) == 0) {	//every byte the same
+		memset(w->io_buf, w->io_buf[0], (size_t)pitch * w->io_h);
+		return;
+	}
+	for (int y = 1; y < w->io_h; y++)
+		memcpy(w->io_buf + (size_t)y * pitch, w->io_buf, bytes);
+}
+
+void io_LockFramebuffer(io_window_t *w, io_framebuffer_t *fb) {
+	fb->pixels = (unsigned char *)w->x_img->data;
+	fb->pitch = w->x_img->bytes_per_line;
+	fb->width = w->io_w;
+	fb->height = w->io_h;
+	fb->format = w->io_fmt;
+	fb->depth = &w->io_depth;
+	w->io_dirty_all = 1;	//raw writes can't be tracked
+}
+
+void io_UnlockFramebuffer(io_window_t *w) {
+	//XShm image is the framebuffer itself, nothing to flush
+}
+
+void io_MarkDirty(io_window_t *w, int x, int y, int width, int height) {
+	if (x < 0) { width += x; x = 0; }
+	if (y < 0) { height += y; y = 0; }
+	if (x + width > w->io_w) width = w->io_w - x;
+	if (y + height > w->io_h) height = w->io_h - y;
+	if (width > 0 && height > 0)
+		st_io_MarkRect(w, x, y, width, height);
+}
+
+void io_DiscardFrame(io_window_t *w) {
+	w->io_discard = 1;
+}
+
+void io_ClearDepth(io_window_t *w, float value) {
+	io_depth_t *d = &w->io_depth;
+	size_t tiles = (size_t)d->tiles_x * d->tiles_y;
+	d->clear = value;
+	for (size_t i = 0; i < tiles; i++)
+		d->zmin[i] = d->zmax[i] = value;
+	memset(d->fresh, 1, tiles);
+}
+
+/*	With several images the one just put is left to the server and
+	drawing moves on to the next one. Only when that one is still
+	being read (all of them in flight) this waits for a completion. */
 void io_UpdateFrame(io_window_t *w) {
-	XShmPutImage(w->x_dpy, w->x_win, w->x_gc, w->x_img, 0, 0, 0, 0, w->io_w, w->io_h, False);
+	int cur = w->x_cur, busy = w->x_bufs[cur].busy;
+	if (!w->io_dirty_all)
+		st_io_PutDirty(w);	//may give up and ask for a full put
+	if (w->io_dirty_all)
+		st_io_Put(w, 0, 0, w->io_w, w->io_h);
 	XFlush(w->x_dpy);
+	if (w->x_bufs[cur].busy != busy) {	//something was put, rotate
+		int next = (cur + 1) % w->x_nbufs;
+		st_io_MarkStale(w);
+		st_io_WaitBuffer(w, next);
+		if (w->io_discard)
+			st_io_ClearStale(w, next);	//overdrawn anyway
+		else
+			st_io_CopyStale(w, cur, next);
+		st_io_UseBuffer(w, next);
+	}
+	w->io_dirty_all = 0;
+	w->io_discard = 0;
+	int ty = (w->io_h + DIRTY_TILE - 1) >> DIRTY_SHIFT;
+	memset(w->io_dirty, 0, sizeof(uint64_t) * w->io_dirty_words * ty);
+}
+
+int io_SetPresentBuffers(io_window_t *w, int n) {
+	if (n < 1) n = 1;
+	if (n > PRESENT_MAX) n = PRESENT_MAX;
+	if (n == w->x_nbufs)
+		return n;
+	st_io_FreeBuffers(w);
+	st_io_CreateBuffers(w, n);
+	st_io_CreateDirty(w);
+	return n;
 }
 
 int io_GetWidth(io_window_t *w){
@@ -284,6 +863,10 @@ void io_PollKeys(io_window_t *w, io_keys_t *c, int mode) {
 	XEvent e;
 	while (mode == BLOCK_POLL || XPending(w->x_dpy)) {
 		XNextEvent(w->x_dpy, &e);
+		if (e.type == w->x_completion) {	//not an input event, doesn't end a nonblocking poll
+			st_HandleCompletion(&e, c, w);
+			continue;
+		}
 		if (e.type < LASTEvent && st_EventHandlers[e.type])
 			st_EventHandlers[e.type](&e, c, w);
 		if (mode == NONBLOCK_POLL)
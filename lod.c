@@ -0,0 +1,184 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)lod.c	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "lod.h"
+
+/*-------------------------------------------------
+	#        Chain File (static)      #
+------------------------------------------------- */
+/*	source.lod holds the header below, level i the binary cache
+	source.lodi.cache (see SaveWavefrontCache). The header is written
+	last, so one newer than the source has all its levels.	*/
+
+#define LOD_MAGIC "CRLD"
+#define LOD_VERSION 2
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	int32_t levels;
+	float ratio[LOD_MAX];
+	float error[LOD_MAX];
+	int32_t nasked;	//what the chain was built for
+	float asked[LOD_MAX - 1];
+} lod_header_t;
+
+//level 0 - the header
+static int LodPath(const char *source, int level, char *out, size_t size){
+	int n = level ? snprintf(out, size, "%s.lod%d.cache", source, level) : snprintf(out, size, "%s.lod", source);
+	return n >= 0 && n < (int)size;
+}
+
+/*	1 if path exists and is not older than source */
+static int IsFresh(const char *path, const char *source){
+	struct stat c, s;
+	if(stat(path, &c) != 0 || stat(source, &s) != 0)
+		return 0;
+	if(c.st_mtim.tv_sec != s.st_mtim.tv_sec)
+		return c.st_mtim.tv_sec > s.st_mtim.tv_sec;
+	return c.st_mtim.tv_nsec >= s.st_mtim.tv_nsec;
+}
+
+static int ReadHeader(const char *path, lod_header_t *h){
+	FILE *f = fopen(path, "rb");
+	if(f == NULL)
+		return -1;
+	int ok = fread(h, sizeof(lod_header_t), 1, f) == 1 && memcmp(h->magic, LOD_MAGIC, 4) == 0 &&
+		h->version == LOD_VERSION && h->levels >= 1 && h->levels <= LOD_MAX &&
+		h->nasked >= 0 && h->nasked < LOD_MAX;
+	fclose(f);
+	return ok ? 0 : -1;
+}
+
+static lod_t *ReadLevels(wavefront_t *obj, const char *source, const lod_header_t *h){
+	lod_t *lod = calloc(1, sizeof(lod_t));
+	if(lod == NULL)
+		return NULL;
+	lod->level[0] = obj;
+	lod->ratio[0] = 1.0f;
+	lod->levels = 1;
+	lod->tolerance = LOD_TOLERANCE;
+	lod->nasked = h->nasked;
+	memcpy(lod->asked, h->asked, sizeof(lod->asked));
+	for(int i = 1; i < h->levels; i++){
+		char path[4096];
+		wavefront_t *l = LodPath(source, i, path, sizeof(path)) ? LoadWavefrontCache(path) : NULL;
+		if(l == NULL){
+			RemoveLod(lod);
+			return NULL;
+		}
+		lod->level[i] = l;
+		lod->ratio[i] = h->ratio[i];
+		lod->error[i] = h->error[i];
+		lod->levels++;
+	}
+	return lod;
+}
+
+/*-------------------------------------------------
+	#        1. Main Public      #
+------------------------------------------------- */
+
+lod_t *BuildLod(wavefront_t *obj, const float *ratio, int n){
+	lod_t *lod = calloc(1, sizeof(lod_t));
+	if(lod == NULL){
+		fprintf(stderr," (err) lod.c: Can't allocate the chain\n");
+		return NULL;
+	}
+	lod->level[0] = obj;
+	lod->ratio[0] = 1.0f;
+	lod->levels = 1;
+	lod->tolerance = LOD_TOLERANCE;
+	lod->nasked = n < LOD_MAX - 1 ? n : LOD_MAX - 1;
+	memcpy(lod->asked, ratio, sizeof(float) * lod->nasked);
+	for(int i = 0; i < n && lod->levels < LOD_MAX; i++){
+		int k = lod->levels;
+		wavefront_t *prev = lod->level[k - 1];
+		float e = 0.0f;
+		if(ratio[i] <= 0.0f || ratio[i] >= lod->ratio[k - 1] || prev->tc == 0)
+			break;	//not falling
+		wavefront_t *l = SimplifyWavefront(prev, ratio[i] * obj->tc / prev->tc, &e);
+		if(l == NULL)
+			break;
+		if(l->tc >= prev->tc){	//nothing left to collapse
+			RemoveWavefront(l);
+			break;
+		}
+		lod->level[k] = l;
+		lod->ratio[k] = ratio[i];
+		lod->error[k] = lod->error[k - 1] + e;
+		lod->levels++;
+	}
+	return lod;
+}
+
+lod_t *LoadLod(wavefront_t *obj, const char *source, const float *ratio, int n){
+	char path[4096];
+	lod_header_t h;
+	if(n > LOD_MAX - 1)
+		n = LOD_MAX - 1;	//BuildLod won't go further
+	int match = LodPath(source, 0, path, sizeof(path)) && IsFresh(path, source) &&
+		ReadHeader(path, &h) == 0 && h.nasked == n;
+	for(int i = 0; i < n && match; i++)
+		match = h.asked[i] == ratio[i];
+	lod_t *lod = match ? ReadLevels(obj, source, &h) : NULL;
+	if(lod == NULL && (lod = BuildLod(obj, ratio, n)) != NULL)
+		SaveLod(lod, source);
+	return lod;
+}
+
+int SaveLod(const lod_t *lod, const char *source){
+	char path[4096];
+	lod_header_t h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, LOD_MAGIC, 4);
+	h.version = LOD_VERSION;
+	h.levels = lod->levels;
+	memcpy(h.ratio, lod->ratio, sizeof(h.ratio));
+	memcpy(h.error, lod->error, sizeof(h.error));
+	h.nasked = lod->nasked;
+	memcpy(h.asked, lod->asked, sizeof(h.asked));
+	for(int i = 1; i < lod->levels; i++)
+		if(!LodPath(source, i, path, sizeof(path)) || SaveWavefrontCache(lod->level[i], path) != 0)
+			return -1;
+	FILE *f = LodPath(source, 0, path, sizeof(path)) ? fopen(path, "wb") : NULL;
+	if(f == NULL){
+		fprintf(stderr," (err) lod.c: Can't write %s.lod\n", source);
+		return -1;
+	}
+	int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+	if(fclose(f) != 0 || !ok){
+		fprintf(stderr," (err) lod.c: Can't write %s\n", path);
+		remove(path);
+		return -1;
+	}
+	return 0;
+}
+
+/*	The surface error of a level shows as error * pixels / diameter
+	on the screen; the coarsest level within the tolerance wins. */
+int LodSelect(const lod_t *lod, float pixels){
+	float d = 2.0f * lod->level[0]->radius;
+	if(d <= 0.0f)
+		return lod->levels - 1;
+	for(int i = lod->levels - 1; i > 0; i--)
+		if(lod->error[i] * pixels <= lod->tolerance * d)
+			return i;
+	return 0;
+}
+
+void RemoveLod(lod_t *lod){
+	for(int i = 1; i < lod->levels; i++)
+		RemoveWavefront(lod->level[i]);
+	free(lod);
+}
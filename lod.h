@@ -0,0 +1,47 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)lod.h	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#ifndef LOD_H_SENTRY
+#define LOD_H_SENTRY
+
+#include "wavefront.h"
+
+/*-------------------------------------------------
+	#        1.LEVELS OF DETAIL     #
+------------------------------------------------- */
+/*	level[0] is the mesh given, every next one is simplified from
+	the one before it down to ratio[i] of level[0]'s triangles.
+	error[i] adds up how far the surface of level i strayed from
+	level[0], in its units; LodSelect turns that into pixels with
+	the size of the bounding sphere on the screen.	*/
+
+#define LOD_MAX 8
+#define LOD_TOLERANCE 1.0f	//pixels of error a level may show, by default
+
+//MAIN SUBJECT:
+typedef struct {
+	wavefront_t *level[LOD_MAX];	//finest first, level[0] is the caller's
+	float ratio[LOD_MAX];	//triangles kept, of level[0]'s
+	float error[LOD_MAX];
+	int levels;
+	float tolerance;	//pixels
+	float asked[LOD_MAX - 1];	//the ratios BuildLod was given, it may stop short of them
+	int nasked;
+} lod_t;
+
+//FUNCS
+lod_t *BuildLod(wavefront_t *obj, const float *ratio, int n);	//ratio[] falling, at most LOD_MAX - 1
+/*	The chain of source (the file obj came from) out of source.lod and
+	source.lod1.cache ... when they are newer than it and were made
+	for the same ratios, or built and written there.	*/
+lod_t *LoadLod(wavefront_t *obj, const char *source, const float *ratio, int n);
+int SaveLod(const lod_t *lod, const char *source);	//0 - ok, -1 - error
+int LodSelect(const lod_t *lod, float pixels);	//level for a bounding sphere pixels across
+void RemoveLod(lod_t *lod);	//level[0] stays
+
+#endif
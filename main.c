@@ -1,37 +1,97 @@
-#include <X11/Xlib.h>
-#include <X11/extensions/XShm.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
+#include <math.h>
 #include "io.h"
+#include "wavefront.h"
+#include "raster.h"
+#include "fb.h"
+#include "bvh.h"
+#include "lod.h"
+#include "texture.h"
 
 #define RGB(r,g,b) (((r)<<16)|((g)<<8)|(b))
 
+static const float LodRatios[] = {0.5f, 0.25f, 0.1f};	//of the triangles, level 1 on
+
 void DrawBackground(io_window_t *w, int width, int height){
+	io_framebuffer_t fb;
+	fb_step_t dx = {256, 0, 0}, dy = {0, 256, 0};
+	io_LockFramebuffer(w, &fb);
+	int done = FbGradient(&fb, 0, 0, width, height, RGB(0, 0, 128), dx, dy) == 0;
+	io_UnlockFramebuffer(w);
+	if (done)
+		return;
+	unsigned int row[width];
 	for (int y = 0; y < height; y++) {
-		for (int x = 0; x < width; x++) {
-			io_SetPixel(w, x, y, RGB(x, y, 128));
-		}
+		for (int x = 0; x < width; x++)
+			row[x] = RGB(x, y, 128);
+		io_WriteSpan(w, 0, y, row, width);
 	}
 }
 
-int main(void) {
+int main(int argc, char **argv) {
+	wavefront_t *obj = NULL;
+	if (argc > 1 && !strcmp(argv[1], "-bench")) {
+		int bad = FbCheck();
+		printf("fb.c: %i mismatches against the scalar kernels\n", bad);
+		FbBench();
+		return bad != 0;
+	}
+	if (argc > 1 && !strcmp(argv[1], "-texbench")) {
+		TextureBench(argc > 2 ? argv[2] : NULL);
+		return 0;
+	}
+	if (argc > 2 && !strcmp(argv[1], "-parsebench")) {
+		WavefrontParseBench(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+		return 0;
+	}
+	if (argc > 2 && !strcmp(argv[1], "-bvh")) {
+		if ((obj = LoadMappedWavefront(argv[2])) == NULL)
+			return 1;
+		BvhBench(obj);
+		RemoveWavefront(obj);
+		return 0;
+	}
+	int persist = argc > 2 && !strcmp(argv[1], "-lod");	//keep the chain in file.obj.lod*
+	const char *file = persist ? argv[2] : argc > 1 ? argv[1] : NULL;
+	if (file && (obj = LoadMappedWavefront(file)) == NULL)
+		return 1;
+	lod_t *lod = NULL;
+	int nratios = sizeof(LodRatios) / sizeof(LodRatios[0]);
+	if (obj) {
+		WavefrontOptimize(obj, NULL);
+		lod = persist ? LoadLod(obj, file, LodRatios, nratios) : BuildLod(obj, LodRatios, nratios);
+	}
 	io_keys_t *c = io_InitKeys();
 	io_window_t *w = io_InitWindow();
+	raster_t *r = InitRaster();
 	int playloop = 1;
+	float angle = 0.0f;
 	while (playloop) {
 		io_PollKeys(w, c, 0);
 		if(c->status[KEY_ESC] == IO_TOGGLED)
 			playloop = 0;
 		DrawBackground(w, io_GetWidth(w), io_GetHeight(w));
+		if (obj) {
+			mat4_t model = mat4_rotate(0.0f, angle, 0.0f);
+			angle = fmodf(angle + 0.01f, 2.0f * (float)M_PI);
+			RasterBegin(r, w);
+			wavefront_t *level = lod ? lod->level[LodSelect(lod, RasterScreenSize(r, obj, &model))] : obj;
+			RasterDrawInstance(r, level, &model, RGB(230, 200, 120));
+			RasterEnd(r);
+		}
+		io_DiscardFrame(w);	//the background covers the window every frame
 		io_UpdateFrame(w);
 	}
+	RemoveRaster(r);
+	if (lod)
+		RemoveLod(lod);
+	if (obj)
+		RemoveWavefront(obj);
 	io_CloseWindow(w);
 	io_FreeKeys(c);
 	return 0;
 }
-
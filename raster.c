@@ -0,0 +1,621 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)raster.c	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "raster.h"
+
+#define GUARD (1 << 20)	//pixels; no clipping yet, bigger triangles are dropped
+#define ZFAR 1000.0f	//depth is znear/w, the projection's z is unused
+
+typedef struct bin bin_t;
+typedef struct range range_t;
+typedef struct worker worker_t;
+
+struct raster {
+	io_window_t *w;
+	io_framebuffer_t fb;
+	raster_camera_t cam;
+	int twosided;
+	mat4_t viewproj;	//from the camera and the framebuffer aspect
+	transform_t xf;	//clip-space copy of the mesh being drawn
+	vector *proj;	//its screen-space points
+	int projcap;
+	raster_stats_t stats;
+	//binned mode (threads > 1): triangles wait in tiles for RasterEnd
+	struct triangle *tris;
+	int ntris, triscap;
+	bin_t *bins;
+	int bins_x, bins_y, binscap;
+	//worker pool, worker 0 is the thread calling RasterEnd
+	int threads;
+	worker_t *workers;
+	range_t *ranges;
+	pthread_mutex_t lock;
+	pthread_cond_t wake, done;
+	int frame, busy, quit;
+};
+
+/*-------------------------------------------------
+	#        Triangle Setup (static)      #
+------------------------------------------------- */
+/*	Half-space rasterization in 28.4 fixed point. Edge i is
+	E(x,y) = c + dx*y - dy*x, a pixel is inside when all three
+	are > 0 at its center. Top-left fill convention.
+	Depth is linear in screen space and bigger is closer (znear/z
+	for meshes), a pixel is written when it beats the depth buffer. */
+
+typedef struct triangle {
+	int64_t c[3];
+	int dx[3], dy[3];
+	int minx, miny, maxx, maxy;	//pixel bbox, max exclusive
+	float z0, zx, zy;	//depth plane: z = z0 + zx*x + zy*y
+	float zmin, zmax;	//over the 3 points
+	uint32_t pixel;	//native format
+} triangle_t;
+
+static inline int Min3(int a, int b, int c){
+	return a < b ? (a < c ? a : c) : (b < c ? b : c);
+}
+
+static inline int Max3(int a, int b, int c){
+	return a > b ? (a > c ? a : c) : (b > c ? b : c);
+}
+
+static int SetupTriangle(triangle_t *t, const float *a, const float *b, const float *c){
+	for(int i = 0; i < 2; i++)
+		if(fabsf(a[i]) > GUARD || fabsf(b[i]) > GUARD || fabsf(c[i]) > GUARD)
+			return 0;
+	int x[3] = {lrintf(a[X] * 16.0f), lrintf(b[X] * 16.0f), lrintf(c[X] * 16.0f)};
+	int y[3] = {lrintf(a[Y] * 16.0f), lrintf(b[Y] * 16.0f), lrintf(c[Y] * 16.0f)};
+	int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(x[2] - x[0]) * (y[1] - y[0]);
+	if(area == 0)
+		return 0;
+	if(area > 0){	//make the inside positive for every edge
+		int tmp = x[1]; x[1] = x[2]; x[2] = tmp;
+		tmp = y[1]; y[1] = y[2]; y[2] = tmp;
+	}
+	for(int i = 0; i < 3; i++){
+		int j = (i + 1) % 3;
+		t->dx[i] = x[i] - x[j];
+		t->dy[i] = y[i] - y[j];
+		t->c[i] = (int64_t)t->dy[i] * x[i] - (int64_t)t->dx[i] * y[i];
+		if(t->dy[i] < 0 || (t->dy[i] == 0 && t->dx[i] > 0))
+			t->c[i]++;
+	}
+	float area2 = (b[X] - a[X]) * (c[Y] - a[Y]) - (c[X] - a[X]) * (b[Y] - a[Y]);
+	t->zx = ((b[Z] - a[Z]) * (c[Y] - a[Y]) - (c[Z] - a[Z]) * (b[Y] - a[Y])) / area2;
+	t->zy = ((c[Z] - a[Z]) * (b[X] - a[X]) - (b[Z] - a[Z]) * (c[X] - a[X])) / area2;
+	t->z0 = a[Z] - t->zx * a[X] - t->zy * a[Y];
+	t->zmin = fminf(a[Z], fminf(b[Z], c[Z]));
+	t->zmax = fmaxf(a[Z], fmaxf(b[Z], c[Z]));
+	t->minx = Min3(x[0], x[1], x[2]) >> 4;
+	t->miny = Min3(y[0], y[1], y[2]) >> 4;
+	t->maxx = (Max3(x[0], x[1], x[2]) >> 4) + 1;
+	t->maxy = (Max3(y[0], y[1], y[2]) >> 4) + 1;
+	return 1;
+}
+
+static inline int64_t Edge(const triangle_t *t, int i, int px, int py){
+	return t->c[i] + (int64_t)t->dx[i] * py - (int64_t)t->dy[i] * px;
+}
+
+/*	Bit n is set when corner n of the block is inside edge i */
+static inline int Corners(const triangle_t *t, int i, int x0, int y0, int x1, int y1){
+	return (Edge(t, i, x0, y0) > 0) | (Edge(t, i, x1, y0) > 0) << 1 |
+		(Edge(t, i, x0, y1) > 0) << 2 | (Edge(t, i, x1, y1) > 0) << 3;
+}
+
+/*-------------------------------------------------
+	#        Block Fill (static)      #
+------------------------------------------------- */
+
+#define TILE_AREA (IO_DEPTH_TILE * IO_DEPTH_TILE)
+
+static inline float *TileZ(io_depth_t *d, int x, int y){
+	return d->z + ((size_t)(y / IO_DEPTH_TILE) * d->tiles_x + x / IO_DEPTH_TILE) * TILE_AREA;
+}
+
+/*	Recomputes the HiZ bounds of the visible w x h part of a tile */
+static void RefreshTile(io_depth_t *d, int tile, const float *z, int w, int h){
+	float lo = z[0], hi = z[0];
+	for(int j = 0; j < h; j++)
+		for(int i = 0; i < w; i++){
+			lo = fminf(lo, z[j * IO_DEPTH_TILE + i]);
+			hi = fmaxf(hi, z[j * IO_DEPTH_TILE + i]);
+		}
+	d->zmin[tile] = lo;
+	d->zmax[tile] = hi;
+}
+
+/*	Whole block inside and in front of everything in the tile */
+static void FillBlock(const io_framebuffer_t *fb, raster_stats_t *st, const triangle_t *t, float *z, int x, int y, int w, int h){
+	unsigned char *row = fb->pixels + (size_t)y * fb->pitch;
+	float zrow = t->z0 + t->zx * (x + 0.5f) + t->zy * (y + 0.5f);
+	for(int j = 0; j < h; j++, row += fb->pitch, z += IO_DEPTH_TILE, zrow += t->zy){
+		uint32_t *span = (uint32_t *)row + x;
+		float zp = zrow;
+		for(int i = 0; i < w; i++, zp += t->zx){
+			span[i] = t->pixel;
+			z[i] = zp;
+		}
+	}
+	st->pixels += w * h;
+}
+
+static long ScanBlock(const io_framebuffer_t *fb, raster_stats_t *st, const triangle_t *t, float *z, int x, int y, int w, int h){
+	int px = (x << 4) + 8, py = (y << 4) + 8;	//first pixel center
+	int64_t cy0 = Edge(t, 0, px, py), cy1 = Edge(t, 1, px, py), cy2 = Edge(t, 2, px, py);
+	float zrow = t->z0 + t->zx * (x + 0.5f) + t->zy * (y + 0.5f);
+	unsigned char *row = fb->pixels + (size_t)y * fb->pitch;
+	long n = 0;
+	for(int j = 0; j < h; j++, row += fb->pitch, z += IO_DEPTH_TILE, zrow += t->zy){
+		uint32_t *span = (uint32_t *)row + x;
+		int64_t cx0 = cy0, cx1 = cy1, cx2 = cy2;
+		float zp = zrow;
+		for(int i = 0; i < w; i++, zp += t->zx){
+			if((cx0 > 0) & (cx1 > 0) & (cx2 > 0) & (zp > z[i])){
+				span[i] = t->pixel;
+				z[i] = zp;
+				n++;
+			}
+			cx0 -= t->dy[0] << 4;
+			cx1 -= t->dy[1] << 4;
+			cx2 -= t->dy[2] << 4;
+		}
+		cy0 += t->dx[0] << 4;
+		cy1 += t->dx[1] << 4;
+		cy2 += t->dx[2] << 4;
+	}
+	st->pixels += n;
+	return n;
+}
+
+/*	Walks the 8x8 blocks of the bbox clipped to [cx0,cx1)x[cy0,cy1)
+	(block aligned). Blocks are rejected by their corners or by the
+	HiZ bounds of their depth tile before any per-pixel work; blocks
+	fully inside and in front are filled without depth tests.	*/
+static void DrawTriangle(const io_framebuffer_t *fb, raster_stats_t *st, const triangle_t *t,
+		int cx0, int cy0, int cx1, int cy1){
+	io_depth_t *d = fb->depth;
+	int minx = t->minx > cx0 ? t->minx : cx0;
+	int miny = t->miny > cy0 ? t->miny : cy0;
+	int maxx = t->maxx < cx1 ? t->maxx : cx1;
+	int maxy = t->maxy < cy1 ? t->maxy : cy1;
+	if(minx >= maxx || miny >= maxy)
+		return;
+	minx &= ~(RASTER_BLOCK - 1);
+	miny &= ~(RASTER_BLOCK - 1);
+	for(int y = miny; y < maxy; y += RASTER_BLOCK){
+		int h = (cy1 - y) < RASTER_BLOCK ? cy1 - y : RASTER_BLOCK;
+		int y0 = (y << 4) + 8, y1 = ((y + RASTER_BLOCK - 1) << 4) + 8;
+		float zy0 = t->z0 + t->zy * (y + 0.5f), zy1 = zy0 + t->zy * (RASTER_BLOCK - 1);
+		int tile = (y / IO_DEPTH_TILE) * d->tiles_x + minx / IO_DEPTH_TILE;
+		for(int x = minx; x < maxx; x += RASTER_BLOCK, tile++){
+			float za = zy0 + t->zx * (x + 0.5f), zb = za + t->zx * (RASTER_BLOCK - 1);
+			float bmax = fminf(t->zmax, fmaxf(fmaxf(za, zb), fmaxf(za - zy0 + zy1, zb - zy0 + zy1)));
+			if(bmax <= d->zmin[tile]){	//behind everything already there
+				st->hiz_blocks++;
+				continue;
+			}
+			int w = (cx1 - x) < RASTER_BLOCK ? cx1 - x : RASTER_BLOCK;
+			int x0 = (x << 4) + 8, x1 = ((x + RASTER_BLOCK - 1) << 4) + 8;
+			int a = Corners(t, 0, x0, y0, x1, y1);
+			int b = Corners(t, 1, x0, y0, x1, y1);
+			int c = Corners(t, 2, x0, y0, x1, y1);
+			if(a == 0 || b == 0 || c == 0)
+				continue;
+			float *z = TileZ(d, x, y);
+			if(d->fresh[tile]){	//lazy part of io_ClearDepth
+				for(int i = 0; i < TILE_AREA; i++)
+					z[i] = d->clear;
+				d->fresh[tile] = 0;
+			}
+			float bmin = fmaxf(t->zmin, fminf(fminf(za, zb), fminf(za - zy0 + zy1, zb - zy0 + zy1)));
+			if((a & b & c) == 0xF && bmin > d->zmax[tile])
+				FillBlock(fb, st, t, z, x, y, w, h);
+			else if(ScanBlock(fb, st, t, z, x, y, w, h) == 0)
+				continue;
+			RefreshTile(d, tile, z, w, h);
+		}
+	}
+}
+
+static uint32_t NativePixel(const io_format_t *f, unsigned int color, int k){	//k - 0..256
+	uint32_t red = (((color >> 16) & 0xFF) * k) >> 8;
+	uint32_t green = (((color >> 8) & 0xFF) * k) >> 8;
+	uint32_t blue = ((color & 0xFF) * k) >> 8;
+	return (red << f->rshift) | (green << f->gshift) | (blue << f->bshift);
+}
+
+/*-------------------------------------------------
+	#        Tile Bins and Workers (static)      #
+------------------------------------------------- */
+/*	Triangles are set up once and their index is appended to every
+	RASTER_TILE x RASTER_TILE bin their bbox touches. At RasterEnd the
+	bins are split in one contiguous range per worker; a worker takes
+	tiles from its own range, then steals from the others. A tile is
+	drawn by exactly one thread, and tiles are depth-tile aligned, so
+	pixels, depth and HiZ need no locks.	*/
+
+struct bin {
+	int *tri;	//in submission order
+	int n, cap;
+};
+
+struct range {
+	atomic_int next;
+	int end;
+	char pad[64 - sizeof(atomic_int) - sizeof(int)];	//one cache line each
+};
+
+struct worker {
+	raster_t *r;
+	int self;
+	int seen;	//last frame drawn
+	pthread_t tid;
+	raster_stats_t stats;
+};
+
+/*	arr itself or its new place; NULL - out of memory, arr and *cap
+	are left as they were */
+static void *Grow(void *arr, int *cap, int need, size_t size){
+	if(need <= *cap)
+		return arr;
+	int newcap = *cap ? *cap : 64;
+	while(newcap < need)
+		newcap *= 2;
+	void *grown = realloc(arr, size * newcap);
+	if(grown != NULL)
+		*cap = newcap;
+	return grown;
+}
+
+//0 - ok, -1 - out of memory, the old bins stay
+static int ResizeBins(raster_t *r){
+	int bx = (r->fb.width + RASTER_TILE - 1) / RASTER_TILE;
+	int by = (r->fb.height + RASTER_TILE - 1) / RASTER_TILE;
+	int n = bx * by;
+	if(n > r->binscap){
+		bin_t *bins = realloc(r->bins, sizeof(bin_t) * n);
+		if(bins == NULL)
+			return -1;
+		memset(bins + r->binscap, 0, sizeof(bin_t) * (n - r->binscap));
+		r->bins = bins;
+		r->binscap = n;
+	}
+	r->bins_x = bx;
+	r->bins_y = by;
+	return 0;
+}
+
+/*	Out of memory the triangle is drawn at once instead, whole or
+	in the tiles it couldn't be binned to; the depth test keeps the
+	order from mattering.	*/
+static void BinTriangle(raster_t *r, const triangle_t *t){
+	int x0 = t->minx < 0 ? 0 : t->minx / RASTER_TILE;
+	int y0 = t->miny < 0 ? 0 : t->miny / RASTER_TILE;
+	int x1 = (t->maxx - 1) / RASTER_TILE, y1 = (t->maxy - 1) / RASTER_TILE;
+	if(x1 >= r->bins_x) x1 = r->bins_x - 1;
+	if(y1 >= r->bins_y) y1 = r->bins_y - 1;
+	if(t->maxx <= 0 || t->maxy <= 0 || x0 > x1 || y0 > y1)
+		return;
+	triangle_t *tris = Grow(r->tris, &r->triscap, r->ntris + 1, sizeof(triangle_t));
+	if(tris == NULL){
+		DrawTriangle(&r->fb, &r->stats, t, 0, 0, r->fb.width, r->fb.height);
+		return;
+	}
+	r->tris = tris;
+	r->tris[r->ntris] = *t;
+	for(int y = y0; y <= y1; y++)
+		for(int x = x0; x <= x1; x++){
+			bin_t *b = &r->bins[y * r->bins_x + x];
+			int *tri = Grow(b->tri, &b->cap, b->n + 1, sizeof(int));
+			if(tri == NULL){
+				int tx = x * RASTER_TILE, ty = y * RASTER_TILE;
+				DrawTriangle(&r->fb, &r->stats, t, tx, ty,
+					tx + RASTER_TILE < r->fb.width ? tx + RASTER_TILE : r->fb.width,
+					ty + RASTER_TILE < r->fb.height ? ty + RASTER_TILE : r->fb.height);
+				continue;
+			}
+			b->tri = tri;
+			b->tri[b->n++] = r->ntris;
+		}
+	r->ntris++;
+}
+
+static void DrawBin(raster_t *r, int tile, raster_stats_t *st){
+	bin_t *b = &r->bins[tile];
+	int x0 = (tile % r->bins_x) * RASTER_TILE, y0 = (tile / r->bins_x) * RASTER_TILE;
+	int x1 = x0 + RASTER_TILE < r->fb.width ? x0 + RASTER_TILE : r->fb.width;
+	int y1 = y0 + RASTER_TILE < r->fb.height ? y0 + RASTER_TILE : r->fb.height;
+	for(int i = 0; i < b->n; i++)
+		DrawTriangle(&r->fb, st, &r->tris[b->tri[i]], x0, y0, x1, y1);
+	b->n = 0;
+}
+
+static void RunTiles(raster_t *r, int self){
+	for(int k = 0; k < r->threads; k++){	//own range first, then steal
+		range_t *rg = &r->ranges[(self + k) % r->threads];
+		for(int tile; (tile = atomic_fetch_add(&rg->next, 1)) < rg->end; )
+			DrawBin(r, tile, &r->workers[self].stats);
+	}
+}
+
+static void *Worker(void *arg){
+	worker_t *wk = arg;
+	raster_t *r = wk->r;
+	pthread_mutex_lock(&r->lock);
+	for(;;){
+		while(r->frame == wk->seen && !r->quit)
+			pthread_cond_wait(&r->wake, &r->lock);
+		if(r->quit)
+			break;
+		wk->seen = r->frame;
+		pthread_mutex_unlock(&r->lock);
+		RunTiles(r, wk->self);
+		pthread_mutex_lock(&r->lock);
+		if(--r->busy == 0)
+			pthread_cond_signal(&r->done);
+	}
+	pthread_mutex_unlock(&r->lock);
+	return NULL;
+}
+
+/*	Draws every bin on all workers and waits for the last tile */
+static void FlushBins(raster_t *r){
+	int tiles = r->bins_x * r->bins_y;
+	for(int k = 0; k < r->threads; k++){
+		atomic_store(&r->ranges[k].next, tiles * k / r->threads);
+		r->ranges[k].end = tiles * (k + 1) / r->threads;
+	}
+	pthread_mutex_lock(&r->lock);
+	r->busy = r->threads - 1;
+	r->frame++;
+	pthread_cond_broadcast(&r->wake);
+	pthread_mutex_unlock(&r->lock);
+	RunTiles(r, 0);
+	pthread_mutex_lock(&r->lock);
+	while(r->busy > 0)
+		pthread_cond_wait(&r->done, &r->lock);
+	pthread_mutex_unlock(&r->lock);
+	for(int k = 0; k < r->threads; k++){
+		r->stats.pixels += r->workers[k].stats.pixels;
+		r->stats.hiz_blocks += r->workers[k].stats.hiz_blocks;
+		memset(&r->workers[k].stats, 0, sizeof(raster_stats_t));
+	}
+	r->ntris = 0;
+}
+
+static void StopWorkers(raster_t *r){
+	if(r->threads <= 1)
+		return;
+	pthread_mutex_lock(&r->lock);
+	r->quit = 1;
+	pthread_cond_broadcast(&r->wake);
+	pthread_mutex_unlock(&r->lock);
+	for(int k = 1; k < r->threads; k++)
+		pthread_join(r->workers[k].tid, NULL);
+	r->quit = 0;
+}
+
+/*	Out of memory there is no pool: r->threads stays 1 and every
+	triangle is drawn as it comes.	*/
+static void StartWorkers(raster_t *r, int threads){
+	r->threads = 1;
+	if(threads <= 1)
+		return;
+	worker_t *workers = realloc(r->workers, sizeof(worker_t) * threads);
+	if(workers != NULL)
+		r->workers = workers;
+	free(r->ranges);
+	r->ranges = aligned_alloc(64, sizeof(range_t) * threads);
+	if(workers == NULL || r->ranges == NULL){
+		fprintf(stderr," (err) raster.c: Can't allocate %i workers, drawing on one\n", threads);
+		return;
+	}
+	memset(r->workers, 0, sizeof(worker_t) * threads);
+	r->workers[0].r = r;
+	for(int k = 1; k < threads; k++){
+		r->workers[k].r = r;
+		r->workers[k].self = k;
+		r->workers[k].seen = r->frame;
+		if(pthread_create(&r->workers[k].tid, NULL, Worker, &r->workers[k]) != 0)
+			break;
+		r->threads++;
+	}
+}
+
+/*	Draws now, or bins for RasterEnd when there is a pool */
+static void Submit(raster_t *r, const triangle_t *t){
+	r->stats.triangles++;
+	if(r->threads > 1)
+		BinTriangle(r, t);
+	else
+		DrawTriangle(&r->fb, &r->stats, t, 0, 0, r->fb.width, r->fb.height);
+}
+
+/*-------------------------------------------------
+	#        1. Main Public      #
+------------------------------------------------- */
+
+raster_t *InitRaster(void){
+	raster_t *r = calloc(1, sizeof(raster_t));
+	if(!r) return NULL;
+	raster_camera_t cam = {1.0f, 0.1f, 0.0f, 0.0f, -3.0f};
+	r->cam = cam;
+	pthread_mutex_init(&r->lock, NULL);
+	pthread_cond_init(&r->wake, NULL);
+	pthread_cond_init(&r->done, NULL);
+	RasterSetThreads(r, 0);
+	return r;
+}
+
+void RemoveRaster(raster_t *r){
+	if(r == NULL) return;
+	StopWorkers(r);
+	for(int i = 0; i < r->binscap; i++)
+		free(r->bins[i].tri);
+	free(r->bins);
+	free(r->tris);
+	free(r->workers);
+	free(r->ranges);
+	free(r->proj);
+	FreeTransform(&r->xf);
+	pthread_mutex_destroy(&r->lock);
+	pthread_cond_destroy(&r->wake);
+	pthread_cond_destroy(&r->done);
+	free(r);
+}
+
+void RasterSetThreads(raster_t *r, int threads){
+	if(threads <= 0)
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(threads < 1)
+		threads = 1;
+	StopWorkers(r);
+	StartWorkers(r, threads);
+}
+
+void RasterSetCamera(raster_t *r, const raster_camera_t *cam){
+	r->cam = *cam;
+}
+
+void RasterScreenRay(raster_t *r, float x, float y, float org[3], float dir[3]){
+	float cx = 0.5f * r->fb.width, cy = 0.5f * r->fb.height;
+	float aspect = r->fb.height ? (float)r->fb.width / r->fb.height : 1.0f;
+	float k = tanf(0.5f * r->cam.fov);	//inverse of the projection scale
+	org[X] = r->cam.x;
+	org[Y] = r->cam.y;
+	org[Z] = r->cam.z;
+	dir[X] = cx > 0 ? (x - cx) / cx * k * aspect : 0.0f;
+	dir[Y] = cy > 0 ? (cy - y) / cy * k : 0.0f;
+	dir[Z] = 1.0f;
+}
+
+/*	Row Y of mvp is the projection scale times the model scale, row W
+	the model scale alone: w is the view depth. INFINITY with the eye
+	inside the sphere. */
+float RasterScreenSize(raster_t *r, const wavefront_t *obj, const mat4_t *model){
+	mat4_t mvp = model ? mat4_mul(&r->viewproj, model) : r->viewproj;
+	vec4_t c = mat4_apply(&mvp, vec4_set(obj->center[X], obj->center[Y], obj->center[Z], 1.0f));
+	vec4_t sy = vec4_set(M4(mvp, Y, 0), M4(mvp, Y, 1), M4(mvp, Y, 2), 0.0f);
+	vec4_t sw = vec4_set(M4(mvp, W, 0), M4(mvp, W, 1), M4(mvp, W, 2), 0.0f);
+	if(c.f[W] <= obj->radius * vec4_length3(sw))
+		return INFINITY;
+	return obj->radius * vec4_length3(sy) / c.f[W] * r->fb.height;
+}
+
+void RasterSetTwoSided(raster_t *r, int twosided){
+	r->twosided = twosided != 0;
+}
+
+void RasterBegin(raster_t *r, io_window_t *w){
+	r->w = w;
+	io_LockFramebuffer(w, &r->fb);
+	if(r->fb.format.layout != IO_XRGB8888 && r->fb.format.layout != IO_XBGR8888){
+		fprintf(stderr," (err) raster.c: %i bytes per pixel is not supported\n", r->fb.format.bpp);
+		r->fb.width = r->fb.height = 0;	//draw nothing
+	}
+	mat4_t view = mat4_translate(-r->cam.x, -r->cam.y, -r->cam.z);
+	mat4_t proj = mat4_perspective(r->cam.fov, r->fb.height ? (float)r->fb.width / r->fb.height : 1.0f,
+		r->cam.znear, ZFAR);
+	r->viewproj = mat4_mul(&proj, &view);
+	io_ClearDepth(w, 0.0f);
+	if(r->threads > 1 && ResizeBins(r) != 0){
+		fprintf(stderr," (err) raster.c: Can't allocate the bins, drawing on one thread\n");
+		StopWorkers(r);
+		r->threads = 1;
+	}
+}
+
+void RasterTriangle(raster_t *r, const float a[3], const float b[3], const float c[3], unsigned int color){
+	triangle_t t;
+	if(!SetupTriangle(&t, a, b, c))
+		return;
+	t.pixel = NativePixel(&r->fb.format, color, 256);
+	Submit(r, &t);
+}
+
+static inline vec4_t ClipToView(const float *q, vec4_t s){
+	return vec4_mul(vec4_set(q[X], q[Y], q[W], 0.0f), s);
+}
+
+/*	Drops the mesh if its box is out of view, transforms every vertex
+	once, then draws the triangles CullBackfaces kept, flat shaded by
+	how much they look at the camera */
+void RasterDrawInstance(raster_t *r, wavefront_t *obj, const mat4_t *model, unsigned int color){
+	mat4_t mvp = model ? mat4_mul(&r->viewproj, model) : r->viewproj;
+	if(CullWavefront(obj, &mvp) == CULL_OUT){
+		r->stats.meshes_culled++;
+		return;
+	}
+	TransformWavefront(&r->xf, obj, model, &r->viewproj);
+	if(r->xf.vc > r->projcap){
+		free(r->proj);
+		r->proj = malloc(sizeof(vector) * r->xf.vc);
+		r->projcap = r->proj ? r->xf.vc : 0;
+		if(r->proj == NULL){
+			fprintf(stderr," (err) raster.c: Can't allocate %i points\n", r->xf.vc);
+			return;
+		}
+	}
+	float cx = 0.5f * r->fb.width, cy = 0.5f * r->fb.height;
+	for(int n = 0; n < r->xf.vc; n++){
+		const float *p = r->xf.clip[n];
+		float k = p[W] >= r->cam.znear ? 1.0f / p[W] : 0.0f;
+		r->proj[n][X] = cx + cx * p[X] * k;
+		r->proj[n][Y] = cy - cy * p[Y] * k;
+		r->proj[n][Z] = p[W] >= r->cam.znear ? r->cam.znear * k : -1.0f;	//-1: behind the near plane
+	}
+	r->stats.backfaces += CullBackfaces(&r->xf, obj, r->twosided);
+	//clip x, y back to view space for the shading
+	vec4_t s = vec4_set(1.0f / M4(r->viewproj, 0, 0), 1.0f / M4(r->viewproj, 1, 1), 1.0f, 0.0f);
+	for(int i = 0; i < r->xf.ntri; i++){
+		const int *v = r->xf.tri + 3 * i;
+		float *a = r->proj[v[0]], *b = r->proj[v[1]], *c = r->proj[v[2]];
+		if(a[Z] < 0 || b[Z] < 0 || c[Z] < 0)
+			continue;
+		triangle_t t;
+		if(!SetupTriangle(&t, a, b, c))
+			continue;
+		//x, y, w of the clip points: w is the view z
+		vec4_t q0 = ClipToView(r->xf.clip[v[0]], s);
+		vec4_t n = vec4_cross3(vec4_sub(ClipToView(r->xf.clip[v[1]], s), q0),
+			vec4_sub(ClipToView(r->xf.clip[v[2]], s), q0));
+		float len = vec4_length3(n);
+		int k = len > 0 ? 64 + (int)(192.0f * fabsf(n.f[Z]) / len) : 64;
+		t.pixel = NativePixel(&r->fb.format, color, k);
+		Submit(r, &t);
+	}
+}
+
+void RasterDrawWavefront(raster_t *r, wavefront_t *obj, unsigned int color){
+	RasterDrawInstance(r, obj, NULL, color);
+}
+
+void RasterEnd(raster_t *r){
+	if(r->threads > 1)
+		FlushBins(r);
+	io_UnlockFramebuffer(r->w);
+	r->w = NULL;
+}
+
+raster_stats_t RasterGetStats(raster_t *r){
+	return r->stats;
+}
+
+void RasterResetStats(raster_t *r){
+	memset(&r->stats, 0, sizeof(r->stats));
+}
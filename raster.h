@@ -0,0 +1,58 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)raster.h	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#ifndef RASTER_H_SENTRY
+#define RASTER_H_SENTRY
+
+#include "io.h"
+#include "wavefront.h"
+#include "transform.h"
+
+/*-------------------------------------------------
+	#        1.RASTERIZER     #
+------------------------------------------------- */
+
+#define RASTER_BLOCK IO_DEPTH_TILE	//trivial accept/reject granularity, pixels
+#define RASTER_TILE 64	//binning tile of the threaded mode, multiple of RASTER_BLOCK
+
+//MAIN SUBJECT:
+typedef struct raster raster_t;
+
+typedef struct {
+	float fov;	//vertical, radians
+	float znear;	//triangles with a point closer than that are skipped
+	float x, y, z;	//camera position, looks along +Z, Y is up
+} raster_camera_t;
+
+typedef struct {
+	long triangles;	//set up and sent to the rasterizer
+	long pixels;	//written to the framebuffer
+	long hiz_blocks;	//8x8 blocks dropped by the HiZ bounds
+	long meshes_culled;	//whole meshes outside the view
+	long backfaces;	//triangles dropped facing away
+} raster_stats_t;
+
+//FUNCS
+raster_t *InitRaster(void);
+void RemoveRaster(raster_t *r);
+void RasterSetCamera(raster_t *r, const raster_camera_t *cam);
+void RasterSetThreads(raster_t *r, int threads);	//0 - one per CPU (default), 1 - draw at once
+void RasterScreenRay(raster_t *r, float x, float y, float org[3], float dir[3]);	//world-space ray through (x, y) of the last frame
+float RasterScreenSize(raster_t *r, const wavefront_t *obj, const mat4_t *model);	//pixels across obj's bounding sphere this frame, for LodSelect
+void RasterSetTwoSided(raster_t *r, int twosided);	//1 - back faces are drawn too (open meshes)
+void RasterBegin(raster_t *r, io_window_t *w);	//locks the framebuffer, clears depth
+void RasterDrawWavefront(raster_t *r, wavefront_t *obj, unsigned int color);
+void RasterDrawInstance(raster_t *r, wavefront_t *obj, const mat4_t *model,
+		unsigned int color);	//obj is drawn through model, its vertices stay as they are
+void RasterTriangle(raster_t *r, const float a[3], const float b[3], const float c[3],
+		unsigned int color);	//screen space: x, y in pixels, z - depth, bigger is closer
+void RasterEnd(raster_t *r);	//all pixels are written when it returns
+raster_stats_t RasterGetStats(raster_t *r);	//counted since InitRaster
+void RasterResetStats(raster_t *r);
+
+#endif
@@ -0,0 +1,362 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)texture.c	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "texture.h"
+#include "bench.h"
+
+#define TILE_SHIFT 3	//log2(TEXTURE_TILE)
+#define TILE_TEXELS (TEXTURE_TILE * TEXTURE_TILE)
+#define OPAQUE 0xFF000000u
+
+/*-------------------------------------------------
+	#        Texel Access (static)      #
+------------------------------------------------- */
+
+static const uint8_t Morton[TEXTURE_TILE] = {0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15};	//bits of x spread out
+
+static inline size_t TexelIndex(const texture_t *t, const texture_level_t *l, int x, int y){
+	if(t->layout == TEXTURE_LINEAR)
+		return (size_t)y * l->pitch + x;
+	size_t tile = (size_t)(y >> TILE_SHIFT) * l->pitch + (x >> TILE_SHIFT);
+	return tile * TILE_TEXELS + (Morton[x & (TEXTURE_TILE - 1)] | Morton[y & (TEXTURE_TILE - 1)] << 1);
+}
+
+static inline const texture_level_t *Level(const texture_t *t, float lod){
+	int i = lod > 0.0f ? (int)(lod + 0.5f) : 0;	//NaN too
+	return &t->level[i < t->levels ? i : t->levels - 1];
+}
+
+//the 2x2 box under a texel of the next level, per channel, rounded
+static inline uint32_t Average4(uint32_t a, uint32_t b, uint32_t c, uint32_t d){
+	uint32_t rb = (a & 0x00FF00FF) + (b & 0x00FF00FF) + (c & 0x00FF00FF) + (d & 0x00FF00FF) + 0x00020002;
+	uint32_t ag = (a >> 8 & 0x00FF00FF) + (b >> 8 & 0x00FF00FF) + (c >> 8 & 0x00FF00FF) +
+		(d >> 8 & 0x00FF00FF) + 0x00020002;
+	return (rb >> 2 & 0x00FF00FF) | (ag << 6 & 0xFF00FF00);
+}
+
+//p + (q - p) * w / 256 per channel, w = 0..256
+static inline uint32_t Lerp(uint32_t p, uint32_t q, uint32_t w){
+	uint32_t rb = (p & 0x00FF00FF) * (256 - w) + (q & 0x00FF00FF) * w;
+	uint32_t ag = (p >> 8 & 0x00FF00FF) * (256 - w) + (q >> 8 & 0x00FF00FF) * w;
+	return (rb >> 8 & 0x00FF00FF) | (ag & 0xFF00FF00);
+}
+
+/*	dst may be src: texel (x, y) is written after everything before
+	it in dst was read from further on in src. An odd side loses its
+	last texel, a side of 1 is read twice.	*/
+static void Downsample(const uint32_t *src, int sw, int sh, uint32_t *dst, int dw, int dh){
+	for(int y = 0; y < dh; y++){
+		const uint32_t *r0 = src + (size_t)(2 * y) * sw;
+		const uint32_t *r1 = src + (size_t)(2 * y + 1 < sh ? 2 * y + 1 : sh - 1) * sw;
+		for(int x = 0; x < dw; x++){
+			int x0 = 2 * x, x1 = 2 * x + 1 < sw ? 2 * x + 1 : sw - 1;
+			dst[(size_t)y * dw + x] = Average4(r0[x0], r0[x1], r1[x0], r1[x1]);
+		}
+	}
+}
+
+static void StoreLevel(texture_t *t, int i, const uint32_t *src){
+	texture_level_t *l = &t->level[i];
+	if(t->layout == TEXTURE_LINEAR){
+		memcpy(l->texel, src, sizeof(uint32_t) * l->width * l->height);
+		return;
+	}
+	for(int y = 0; y < l->height; y++)
+		for(int x = 0; x < l->width; x++)
+			l->texel[TexelIndex(t, l, x, y)] = src[(size_t)y * l->width + x];
+}
+
+/*-------------------------------------------------
+	#        Image Files (static)      #
+------------------------------------------------- */
+
+static unsigned char *ReadFile(const char *path, size_t *len){
+	FILE *f = fopen(path, "rb");
+	if(f == NULL)
+		return NULL;
+	unsigned char *buf = NULL;
+	long size = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+	if(size >= 0 && fseek(f, 0, SEEK_SET) == 0 && (buf = malloc(size ? size : 1)) != NULL &&
+			fread(buf, 1, size, f) != (size_t)size){
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+	*len = (size_t)size;
+	return buf;
+}
+
+//next number of a PNM header, comments skipped; NULL at the end
+static const unsigned char *PnmNumber(const unsigned char *p, const unsigned char *end, int *out){
+	while(p < end && (*p == '#' || *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+		if(*p++ == '#')
+			while(p < end && *p != '\n')
+				p++;
+	if(p == end || *p < '0' || *p > '9')
+		return NULL;
+	for(*out = 0; p < end && *p >= '0' && *p <= '9' && *out < (1 << 24); p++)
+		*out = *out * 10 + (*p - '0');
+	return p;
+}
+
+static uint32_t *ParsePnm(const unsigned char *buf, size_t len, int *w, int *h){
+	const unsigned char *p = buf + 2, *end = buf + len;
+	int max = 0, channels = buf[1] == '6' ? 3 : 1;
+	if((p = PnmNumber(p, end, w)) == NULL || (p = PnmNumber(p, end, h)) == NULL ||
+			(p = PnmNumber(p, end, &max)) == NULL || p == end || max < 1 || max > 65535)
+		return NULL;
+	p++;	//one blank before the raster
+	int bytes = max > 255 ? 2 : 1;
+	if(*w < 1 || *h < 1 || (size_t)(end - p) / ((size_t)channels * bytes) / *w < (size_t)*h)
+		return NULL;
+	uint32_t *pixels = malloc(sizeof(uint32_t) * *w * *h);
+	if(pixels == NULL)
+		return NULL;
+	for(size_t i = 0; i < (size_t)*w * *h; i++){
+		uint32_t c[3];
+		for(int k = 0; k < channels; k++, p += bytes){
+			uint32_t v = bytes == 2 ? (uint32_t)p[0] << 8 | p[1] : p[0];
+			c[k] = (v * 255 + max / 2) / max;
+		}
+		pixels[i] = channels == 3 ? OPAQUE | c[0] << 16 | c[1] << 8 | c[2] : OPAQUE | c[0] * 0x010101u;
+	}
+	return pixels;
+}
+
+//types 2 (true color, 24 or 32 bits) and 3 (grey, 8 bits)
+static uint32_t *ParseTga(const unsigned char *buf, size_t len, int *w, int *h){
+	if(len < 18 || buf[1] != 0)	//no color maps
+		return NULL;
+	int type = buf[2], bpp = buf[16], top = buf[17] & 0x20;
+	*w = buf[12] | buf[13] << 8;
+	*h = buf[14] | buf[15] << 8;
+	if(!((type == 2 && (bpp == 24 || bpp == 32)) || (type == 3 && bpp == 8)) || *w < 1 || *h < 1)
+		return NULL;
+	if((size_t)18 + buf[0] > len)	//image ID runs past the end
+		return NULL;
+	const unsigned char *p = buf + 18 + buf[0];
+	size_t bytes = bpp / 8;
+	if((size_t)(buf + len - p) / bytes / *w < (size_t)*h)
+		return NULL;
+	uint32_t *pixels = malloc(sizeof(uint32_t) * *w * *h);
+	if(pixels == NULL)
+		return NULL;
+	for(int y = 0; y < *h; y++){
+		uint32_t *row = pixels + (size_t)(top ? y : *h - 1 - y) * *w;	//bottom row first, unless top
+		for(int x = 0; x < *w; x++, p += bytes)
+			row[x] = bytes == 1 ? OPAQUE | p[0] * 0x010101u :
+				(bytes == 4 ? (uint32_t)p[3] << 24 : OPAQUE) | p[2] << 16 | p[1] << 8 | p[0];
+	}
+	return pixels;
+}
+
+/*-------------------------------------------------
+	#        1. Main Public      #
+------------------------------------------------- */
+
+texture_t *LoadTexture(const char *filename, int layout){
+	size_t len = 0;
+	unsigned char *buf = ReadFile(filename, &len);
+	if(buf == NULL){
+		fprintf(stderr," (err) texture.c: Failed to open %s\n", filename);
+		return NULL;
+	}
+	const char *ext = strrchr(filename, '.');
+	int w = 0, h = 0;
+	uint32_t *pixels = NULL;
+	if(len > 2 && buf[0] == 'P' && (buf[1] == '5' || buf[1] == '6'))
+		pixels = ParsePnm(buf, len, &w, &h);
+	else if(ext && !strcasecmp(ext, ".tga"))
+		pixels = ParseTga(buf, len, &w, &h);
+	free(buf);
+	if(pixels == NULL){
+		fprintf(stderr," (err) texture.c: %s is not a binary PPM/PGM or an uncompressed TGA\n", filename);
+		return NULL;
+	}
+	texture_t *t = NewTexture(pixels, w, h, layout);
+	free(pixels);
+	return t;
+}
+
+texture_t *NewTexture(const uint32_t *pixels, int width, int height, int layout){
+	if(width < 1 || height < 1 || width > 1 << (TEXTURE_LEVELS - 1) || height > 1 << (TEXTURE_LEVELS - 1)){
+		fprintf(stderr," (err) texture.c: Bad size %ix%i\n", width, height);
+		return NULL;
+	}
+	texture_t *t = calloc(1, sizeof(texture_t));
+	if(t == NULL)
+		return NULL;
+	t->layout = layout;
+	size_t total = 0, offset[TEXTURE_LEVELS];
+	for(int w = width, h = height; ; w = w > 1 ? w / 2 : 1, h = h > 1 ? h / 2 : 1){
+		texture_level_t *l = &t->level[t->levels];
+		l->width = w;
+		l->height = h;
+		if(layout == TEXTURE_TILED){
+			l->pitch = (w + TEXTURE_TILE - 1) >> TILE_SHIFT;
+			offset[t->levels++] = total;
+			total += (size_t)l->pitch * ((h + TEXTURE_TILE - 1) >> TILE_SHIFT) * TILE_TEXELS;
+		} else {
+			l->pitch = w;
+			offset[t->levels++] = total;
+			total += ((size_t)w * h + 15) & ~(size_t)15;	//levels start on a cache line
+		}
+		if(w == 1 && h == 1)
+			break;
+	}
+	uint32_t *data = aligned_alloc(64, sizeof(uint32_t) * total);
+	int w1 = width > 1 ? width / 2 : 1, h1 = height > 1 ? height / 2 : 1;
+	uint32_t *scratch = t->levels > 1 ? malloc(sizeof(uint32_t) * w1 * h1) : NULL;
+	if(data == NULL || (t->levels > 1 && scratch == NULL)){
+		fprintf(stderr," (err) texture.c: Can't allocate %ix%i texels\n", width, height);
+		free(data);
+		free(t);
+		return NULL;
+	}
+	memset(data, 0, sizeof(uint32_t) * total);	//tiles past the edge too
+	for(int i = 0; i < t->levels; i++)
+		t->level[i].texel = data + offset[i];
+	StoreLevel(t, 0, pixels);
+	const uint32_t *src = pixels;
+	for(int i = 1; i < t->levels; i++){
+		const texture_level_t *a = &t->level[i - 1], *b = &t->level[i];
+		Downsample(src, a->width, a->height, scratch, b->width, b->height);
+		StoreLevel(t, i, scratch);
+		src = scratch;
+	}
+	free(scratch);
+	return t;
+}
+
+void RemoveTexture(texture_t *t){
+	free(t->level[0].texel);	//all levels
+	free(t);
+}
+
+/*	log2 of the longer texel footprint of a pixel on level 0 */
+float TextureLod(const texture_t *t, float dudx, float dvdx, float dudy, float dvdy){
+	float w = (float)t->level[0].width, h = (float)t->level[0].height;
+	float x = dudx * dudx * w * w + dvdx * dvdx * h * h;
+	float y = dudy * dudy * w * w + dvdy * dvdy * h * h;
+	float rho = fmaxf(x, y);
+	return rho > 1.0f ? 0.5f * log2f(rho) : 0.0f;
+}
+
+uint32_t TextureNearest(const texture_t *t, float u, float v, float lod){
+	const texture_level_t *l = Level(t, lod);
+	float fu = u - floorf(u), fv = (1.0f - v) - floorf(1.0f - v);	//rows go down
+	int x = (int)(fu * l->width), y = (int)(fv * l->height);
+	x = x < l->width ? x : l->width - 1;	//fu * width rounded up to width
+	y = y < l->height ? y : l->height - 1;
+	return l->texel[TexelIndex(t, l, x, y)];
+}
+
+uint32_t TextureBilinear(const texture_t *t, float u, float v, float lod){
+	const texture_level_t *l = Level(t, lod);
+	float fx = (u - floorf(u)) * l->width - 0.5f;	//texel centers are at .5
+	float fy = ((1.0f - v) - floorf(1.0f - v)) * l->height - 0.5f;
+	float x0f = floorf(fx), y0f = floorf(fy);
+	uint32_t wx = (uint32_t)((fx - x0f) * 256.0f), wy = (uint32_t)((fy - y0f) * 256.0f);
+	int x0 = (int)x0f, y0 = (int)y0f;
+	x0 = x0 < 0 ? l->width - 1 : x0 < l->width ? x0 : l->width - 1;
+	y0 = y0 < 0 ? l->height - 1 : y0 < l->height ? y0 : l->height - 1;
+	int x1 = x0 + 1 < l->width ? x0 + 1 : 0, y1 = y0 + 1 < l->height ? y0 + 1 : 0;
+	uint32_t top = Lerp(l->texel[TexelIndex(t, l, x0, y0)], l->texel[TexelIndex(t, l, x1, y0)], wx);
+	uint32_t bottom = Lerp(l->texel[TexelIndex(t, l, x0, y1)], l->texel[TexelIndex(t, l, x1, y1)], wx);
+	return Lerp(top, bottom, wy);
+}
+
+/*-------------------------------------------------
+	#        2. Benchmark      #
+------------------------------------------------- */
+/*	A screen of BENCH_W x BENCH_H pixels mapped onto the texture at an
+	angle and a scale; rotated walks cross rows of a linear texture
+	every texel, minified ones skip whole cache lines.	*/
+
+#define BENCH_SIZE 2048	//generated texture
+#define BENCH_W 1024
+#define BENCH_H 1024
+
+typedef struct {
+	const char *name;
+	float angle;	//degrees
+	float scale;	//level 0 texels per pixel
+	int mip;	//0 - always level 0
+} pattern_t;
+
+//one screen; the sum keeps the samples alive, out[] (may be NULL) gets them
+static uint32_t Frame(const texture_t *t, const pattern_t *p, int bilinear, uint32_t *out){
+	float a = p->angle * (float)M_PI / 180.0f;
+	float dudx = cosf(a) * p->scale / t->level[0].width, dvdx = sinf(a) * p->scale / t->level[0].height;
+	float dudy = -sinf(a) * p->scale / t->level[0].width, dvdy = cosf(a) * p->scale / t->level[0].height;
+	float lod = p->mip ? TextureLod(t, dudx, dvdx, dudy, dvdy) : 0.0f;
+	uint32_t sum = 0;
+	for(int y = 0; y < BENCH_H; y++){
+		float u = 0.25f + y * dudy, v = 0.25f + y * dvdy;
+		for(int x = 0; x < BENCH_W; x++, u += dudx, v += dvdx){
+			uint32_t c = bilinear ? TextureBilinear(t, u, v, lod) : TextureNearest(t, u, v, lod);
+			sum += c;
+			if(out)
+				out[y * BENCH_W + x] = c;
+		}
+	}
+	return sum;
+}
+
+void TextureBench(const char *filename){
+	static const pattern_t patterns[] = {
+		{"0 deg 1:1", 0.0f, 1.0f, 0}, {"90 deg 1:1", 90.0f, 1.0f, 0}, {"30 deg 1:1", 30.0f, 1.0f, 0},
+		{"30 deg 4:1", 30.0f, 4.0f, 0}, {"30 deg 4:1 mip", 30.0f, 4.0f, 1}};
+	static const char *layouts[] = {"linear", "tiled"};
+	uint32_t *pixels = filename ? NULL : malloc(sizeof(uint32_t) * BENCH_SIZE * BENCH_SIZE);
+	uint32_t *ref = malloc(sizeof(uint32_t) * BENCH_W * BENCH_H);
+	uint32_t *out = malloc(sizeof(uint32_t) * BENCH_W * BENCH_H);
+	if(pixels){
+		uint32_t seed = 7;
+		for(int i = 0; i < BENCH_SIZE * BENCH_SIZE; i++)	//noise over a checker board
+			pixels[i] = OPAQUE | (BenchRandom(&seed) & 0x3F3F3F) |
+				((i / BENCH_SIZE >> 5 ^ i % BENCH_SIZE >> 5) & 1) * 0xC0C0C0;
+	}
+	texture_t *tex[2];
+	for(int k = 0; k < 2; k++)
+		tex[k] = filename ? LoadTexture(filename, k) : pixels ? NewTexture(pixels, BENCH_SIZE, BENCH_SIZE, k) : NULL;
+	if(tex[0] && tex[1] && ref && out)
+		for(size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++)
+			for(int bilinear = 0; bilinear < 2; bilinear++){
+				const pattern_t *p = &patterns[i];
+				Frame(tex[0], p, bilinear, ref);
+				Frame(tex[1], p, bilinear, out);
+				int bad = 0;
+				for(int j = 0; j < BENCH_W * BENCH_H; j++)
+					bad += ref[j] != out[j];
+				for(int k = 0; k < 2; k++){
+					long frames = 0;
+					double t0 = BenchNow(), dt;
+					volatile uint32_t sink = 0;
+					do {
+						sink += Frame(tex[k], p, bilinear, NULL);
+						frames++;
+					} while((dt = BenchNow() - t0) < BENCH_SECONDS);
+					printf("texture.c: %-6s %-8s %-14s %8.1f Mtexels/s, %i mismatches (%ix%i)\n", layouts[k],
+						bilinear ? "bilinear" : "nearest", p->name, (double)frames * BENCH_W * BENCH_H / dt * 1e-6,
+						bad, tex[k]->level[0].width, tex[k]->level[0].height);
+				}
+			}
+	for(int k = 0; k < 2; k++)
+		if(tex[k])
+			RemoveTexture(tex[k]);
+	free(pixels);
+	free(ref);
+	free(out);
+}
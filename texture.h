@@ -0,0 +1,54 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)texture.h	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#ifndef TEXTURE_H_SENTRY
+#define TEXTURE_H_SENTRY
+
+#include <stdint.h>
+
+/*-------------------------------------------------
+	#        1.TEXTURES     #
+------------------------------------------------- */
+/*	Texels are 0xAARRGGBB (alpha 0xFF when the image has none), each
+	mip level half the one before down to 1x1. TEXTURE_TILED keeps a
+	level in TEXTURE_TILE x TEXTURE_TILE tiles, row by row, with the
+	texels of a tile in Morton order: a texel's neighbours are in the
+	same 256 bytes whichever way the texture is walked.
+	Coordinates are the ones of obj->texture: u to the right, v up,
+	repeated outside 0..1.	*/
+
+#define TEXTURE_LEVELS 16	//up to 32768 texels a side
+#define TEXTURE_TILE 8
+
+enum {TEXTURE_LINEAR, TEXTURE_TILED};
+
+typedef struct {
+	int width, height;
+	int pitch;	//LINEAR: texels per row, TILED: tiles per row
+	uint32_t *texel;
+} texture_level_t;
+
+//MAIN SUBJECT:
+typedef struct {
+	int layout;	//TEXTURE_*
+	int levels;
+	texture_level_t level[TEXTURE_LEVELS];	//mip 0 first, all in one allocation
+} texture_t;
+
+//FUNCS
+texture_t *LoadTexture(const char *filename, int layout);	//binary PPM (P5, P6) or uncompressed TGA
+texture_t *NewTexture(const uint32_t *pixels, int width, int height, int layout);	//pixels row by row, top first
+void RemoveTexture(texture_t *t);
+/*	The mip level a pixel covers, from how far u and v move
+	between it and the pixel to its right (dx) and below (dy). */
+float TextureLod(const texture_t *t, float dudx, float dvdx, float dudy, float dvdy);
+uint32_t TextureNearest(const texture_t *t, float u, float v, float lod);	//the nearest level, then texel
+uint32_t TextureBilinear(const texture_t *t, float u, float v, float lod);	//the nearest level, 4 texels
+void TextureBench(const char *filename);	//linear against tiled sampling of it, NULL - a generated texture
+
+#endif
@@ -0,0 +1,120 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)transform.c	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "transform.h"
+
+/*-------------------------------------------------
+	#        1. Transform Stage      #
+------------------------------------------------- */
+
+void TransformWavefront(transform_t *t, const wavefront_t *obj,
+		const mat4_t *model, const mat4_t *viewproj){
+	mat4_t mvp = model ? mat4_mul(viewproj, model) : *viewproj;
+	if(obj->vc > t->clipcap){
+		free(t->clip);
+		t->clip = aligned_alloc(16, sizeof(float[4]) * obj->vc);
+		t->clipcap = t->clip ? obj->vc : 0;
+	}
+	if(t->clipcap < obj->vc){
+		fprintf(stderr," (err) transform.c: Can't allocate %i points\n", obj->vc);
+		t->vc = 0;
+		return;
+	}
+	t->vc = obj->vc;
+	vec3_project_n(&mvp, t->clip, obj->vertex, obj->vc);
+}
+
+void TransformNormals(transform_t *t, const wavefront_t *obj, const mat4_t *model){
+	mat4_t id = mat4_identity();
+	if(model == NULL)
+		model = &id;
+	if(obj->vnc > t->normalcap){
+		free(t->normal);
+		t->normal = malloc(sizeof(vector) * obj->vnc);
+		t->normalcap = t->normal ? obj->vnc : 0;
+	}
+	if(t->normalcap < obj->vnc){
+		fprintf(stderr," (err) transform.c: Can't allocate %i normals\n", obj->vnc);
+		t->vnc = 0;
+		return;
+	}
+	t->vnc = obj->vnc;
+	if(obj->vnc){
+		mat4_t n = mat4_normal(model);
+		vec3_rotate_n(&n, t->normal, obj->normal, obj->vnc);
+		vec3_normalize_n(t->normal, obj->vnc);
+	}
+}
+
+void FreeTransform(transform_t *t){
+	free(t->clip);
+	free(t->normal);
+	free(t->tri);
+	memset(t, 0, sizeof(transform_t));
+}
+
+/*-------------------------------------------------
+	#        2. Culling      #
+------------------------------------------------- */
+
+/*	Planes of the clip volume -w <= x, y <= w, 0 <= z <= w as rows
+	of mvp: a point p of obj is inside plane k when dot(k, p) >= 0.
+	The box is out when its corner furthest along a plane is not.	*/
+int CullWavefront(const wavefront_t *obj, const mat4_t *mvp){
+	static const float sign[6][2] = {{1, 1}, {1, -1}, {1, 1}, {1, -1}, {0, 1}, {1, -1}};
+	static const int axis[6] = {0, 0, 1, 1, 2, 2};
+	int result = CULL_IN;
+	for(int k = 0; k < 6; k++){
+		float plane[4], near = 0.0f, far = 0.0f;
+		for(int j = 0; j < 4; j++)
+			plane[j] = sign[k][0] * M4(*mvp, W, j) + sign[k][1] * M4(*mvp, axis[k], j);
+		for(int j = 0; j < 3; j++){
+			float lo = plane[j] * obj->bmin[j], hi = plane[j] * obj->bmax[j];
+			far += fmaxf(lo, hi);
+			near += fminf(lo, hi);
+		}
+		if(far + plane[W] < 0)
+			return CULL_OUT;
+		if(near + plane[W] < 0)
+			result = CULL_CLIP;
+	}
+	return result;
+}
+
+/*	The winding is the sign of det(x y w) of the three clip points,
+	which is the screen-space area sign without the divides. One pass
+	over obj->tri with no branch per triangle: every triangle is
+	written and the count only moves past the kept ones.	*/
+int CullBackfaces(transform_t *t, const wavefront_t *obj, int twosided){
+	if(obj->tc > t->tricap){
+		free(t->tri);
+		t->tri = malloc(sizeof(int[3]) * obj->tc);
+		t->tricap = t->tri ? obj->tc : 0;
+	}
+	t->ntri = 0;
+	if(t->tricap < obj->tc || t->vc < obj->vc)
+		return 0;
+	int *out = t->tri, dropped = 0;
+	for(const uint32_t *v = obj->tri, *end = v + 3 * obj->tc; v < end; v += 3){
+		const float *a = t->clip[v[0]], *b = t->clip[v[1]], *c = t->clip[v[2]];
+		float det = a[X] * (b[Y] * c[W] - b[W] * c[Y]) - a[Y] * (b[X] * c[W] - b[W] * c[X]) +
+			a[W] * (b[X] * c[Y] - b[Y] * c[X]);
+		int keep = twosided | (det < 0) | (a[W] <= 0) | (b[W] <= 0) | (c[W] <= 0);
+		out[0] = v[0];
+		out[1] = v[1];
+		out[2] = v[2];
+		out += 3 * keep;
+		dropped += !keep;
+	}
+	t->ntri = (int)(out - t->tri) / 3;
+	return dropped;
+}
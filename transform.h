@@ -0,0 +1,51 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)transform.h	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#ifndef TRANSFORM_H_SENTRY
+#define TRANSFORM_H_SENTRY
+
+#include "wavefront.h"
+
+/*-------------------------------------------------
+	#        1.TRANSFORM STAGE     #
+------------------------------------------------- */
+
+//MAIN SUBJECT:
+typedef struct {
+	float (*clip)[4];	//vc points, x y z w
+	vector *normal;	//vnc normals in world space, unit length; TransformNormals only
+	int vc, vnc;
+	int clipcap, normalcap;
+	int *tri;	//ntri triangles, 3 vertex numbers (from 0) each
+	int ntri, tricap;
+} transform_t;
+
+/*	One pass over the source arrays, which are left untouched.
+	model may be NULL (identity). Buffers are reused between calls.
+	Normals are left to TransformNormals, for whoever shades with them. */
+void TransformWavefront(transform_t *t, const wavefront_t *obj,
+		const mat4_t *model, const mat4_t *viewproj);	//clip points
+void TransformNormals(transform_t *t, const wavefront_t *obj, const mat4_t *model);
+void FreeTransform(transform_t *t);	//the struct itself stays
+
+/*-------------------------------------------------
+	#        2.CULLING     #
+------------------------------------------------- */
+/*	CullWavefront tests the bounding box of obj against the view
+	frustum of mvp (object to clip space), before any vertex work.
+	CullBackfaces runs after TransformWavefront: it keeps in t->tri
+	the triangles of obj->tri that are wound clockwise on the
+	screen, plus those with a point behind the eye, whose winding
+	can't be told there.	*/
+
+enum {CULL_OUT, CULL_CLIP, CULL_IN};
+
+int CullWavefront(const wavefront_t *obj, const mat4_t *mvp);	//CULL_*
+int CullBackfaces(transform_t *t, const wavefront_t *obj, int twosided);	//number dropped
+
+#endif
@@ -0,0 +1,274 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)vecmath.c	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#include <string.h>
+#include <math.h>
+#include "vecmath.h"
+
+/*-------------------------------------------------
+	#        1. Matrices      #
+------------------------------------------------- */
+
+mat4_t mat4_identity(void){
+	mat4_t r;
+	memset(&r, 0, sizeof(r));
+	for(int i = 0; i < 4; i++)
+		M4(r, i, i) = 1.0f;
+	return r;
+}
+
+mat4_t mat4_mul(const mat4_t *a, const mat4_t *b){
+	mat4_t r;
+	for(int j = 0; j < 4; j++)
+		r.c[j] = mat4_apply(a, b->c[j]);
+	return r;
+}
+
+mat4_t mat4_translate(float dx, float dy, float dz){
+	mat4_t r = mat4_identity();
+	r.c[3] = vec4_set(dx, dy, dz, 1.0f);
+	return r;
+}
+
+mat4_t mat4_scale(float sx, float sy, float sz){
+	mat4_t r = mat4_identity();
+	M4(r, 0, 0) = sx;
+	M4(r, 1, 1) = sy;
+	M4(r, 2, 2) = sz;
+	return r;
+}
+
+mat4_t mat4_rotate(float alpha, float beta, float gamma){
+	float sa = sinf(alpha), ca = cosf(alpha);
+	float sb = sinf(beta), cb = cosf(beta);
+	float sg = sinf(gamma), cg = cosf(gamma);
+	mat4_t r = mat4_identity();
+	M4(r, 0, 0) = cb * cg;
+	M4(r, 0, 1) = -sg * cb;
+	M4(r, 0, 2) = sb;
+	M4(r, 1, 0) = sa * sb * cg + sg * ca;
+	M4(r, 1, 1) = -sa * sb * sg + ca * cg;
+	M4(r, 1, 2) = -sa * cb;
+	M4(r, 2, 0) = sa * sg - sb * ca * cg;
+	M4(r, 2, 1) = sa * cg + sb * sg * ca;
+	M4(r, 2, 2) = ca * cb;
+	return r;
+}
+
+/*	x and y are scaled so that x/w, y/w are -1..1 at the edges of
+	the view, z/w goes 0..1 from znear to zfar.	*/
+mat4_t mat4_perspective(float fov, float aspect, float znear, float zfar){
+	float f = 1.0f / tanf(0.5f * fov);
+	mat4_t r;
+	memset(&r, 0, sizeof(r));
+	M4(r, 0, 0) = f / aspect;
+	M4(r, 1, 1) = f;
+	M4(r, 2, 2) = zfar / (zfar - znear);
+	M4(r, 2, 3) = -znear * zfar / (zfar - znear);
+	M4(r, 3, 2) = 1.0f;
+	return r;
+}
+
+/*	Cofactors of the 3x3 part: the inverse-transpose times |det|,
+	so normals stay normal under any scale.	*/
+mat4_t mat4_normal(const mat4_t *m){
+	mat4_t r = mat4_identity();
+	for(int i = 0; i < 3; i++)
+		for(int j = 0; j < 3; j++){
+			int i1 = (i + 1) % 3, i2 = (i + 2) % 3, j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+			M4(r, i, j) = M4(*m, i1, j1) * M4(*m, i2, j2) - M4(*m, i1, j2) * M4(*m, i2, j1);
+		}
+	float det = M4(*m, 0, 0) * M4(r, 0, 0) + M4(*m, 0, 1) * M4(r, 0, 1) + M4(*m, 0, 2) * M4(r, 0, 2);
+	if(det < 0)
+		for(int j = 0; j < 3; j++)
+			r.c[j] = vec4_scale(r.c[j], -1.0f);
+	return r;
+}
+
+/*	Cofactors as in mat4_normal, transposed over the determinant;
+	the translation goes back through that. */
+int mat4_inverse_affine(const mat4_t *m, mat4_t *out){
+	mat4_t r = mat4_identity();
+	float c[3][3];
+	for(int i = 0; i < 3; i++)
+		for(int j = 0; j < 3; j++){
+			int i1 = (i + 1) % 3, i2 = (i + 2) % 3, j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+			c[i][j] = M4(*m, i1, j1) * M4(*m, i2, j2) - M4(*m, i1, j2) * M4(*m, i2, j1);
+		}
+	float det = M4(*m, 0, 0) * c[0][0] + M4(*m, 0, 1) * c[0][1] + M4(*m, 0, 2) * c[0][2];
+	if(det == 0.0f)
+		return -1;
+	for(int i = 0; i < 3; i++)
+		for(int j = 0; j < 3; j++)
+			M4(r, i, j) = c[j][i] / det;
+	for(int i = 0; i < 3; i++)
+		M4(r, i, 3) = -(M4(r, i, 0) * M4(*m, 0, 3) + M4(r, i, 1) * M4(*m, 1, 3) + M4(r, i, 2) * M4(*m, 2, 3));
+	*out = r;
+	return 0;
+}
+
+/*-------------------------------------------------
+	#        2. Batches      #
+------------------------------------------------- */
+
+#if defined(VECMATH_SSE)
+
+typedef struct {
+	__m128 x, y, z;
+} soa_t;
+
+/*	[x0 y0 z0 x1] [y1 z1 x2 y2] [z2 x3 y3 z3] <-> x, y, z lanes */
+static inline soa_t Load4(const vector *p){
+	const float *f = p[0];
+	__m128 a = _mm_loadu_ps(f), b = _mm_loadu_ps(f + 4), c = _mm_loadu_ps(f + 8);
+	soa_t s;
+	__m128 t = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+	s.x = _mm_shuffle_ps(a, t, _MM_SHUFFLE(2, 0, 3, 0));
+	t = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+	__m128 u = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+	s.y = _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 2, 0));
+	t = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+	u = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));
+	s.z = _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 2, 0));
+	return s;
+}
+
+static inline void Store4(vector *p, soa_t s){
+	float *f = p[0];
+	__m128 t = _mm_shuffle_ps(s.x, s.y, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 u = _mm_shuffle_ps(s.z, s.x, _MM_SHUFFLE(1, 1, 0, 0));
+	_mm_storeu_ps(f, _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 2, 0)));
+	t = _mm_shuffle_ps(s.y, s.z, _MM_SHUFFLE(1, 1, 1, 1));
+	u = _mm_shuffle_ps(s.x, s.y, _MM_SHUFFLE(2, 2, 2, 2));
+	_mm_storeu_ps(f + 4, _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 2, 0)));
+	t = _mm_shuffle_ps(s.z, s.x, _MM_SHUFFLE(3, 3, 2, 2));
+	u = _mm_shuffle_ps(s.y, s.z, _MM_SHUFFLE(3, 3, 3, 3));
+	_mm_storeu_ps(f + 8, _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+static inline __m128 Row(const mat4_t *m, int r, int c){
+	return _mm_set1_ps(M4(*m, r, c));
+}
+
+//w - 1 for points, 0 for directions
+static void Transform4(const mat4_t *m, vector *out, const vector *in, int n, int w){
+	int i = 0;
+	for(; i + 4 <= n; i += 4){
+		soa_t s = Load4(in + i), d;
+		__m128 *o[3] = {&d.x, &d.y, &d.z};
+		for(int r = 0; r < 3; r++){
+			__m128 v = _mm_mul_ps(Row(m, r, 0), s.x);
+			v = _mm_add_ps(v, _mm_mul_ps(Row(m, r, 1), s.y));
+			v = _mm_add_ps(v, _mm_mul_ps(Row(m, r, 2), s.z));
+			*o[r] = w ? _mm_add_ps(v, Row(m, r, 3)) : v;
+		}
+		Store4(out + i, d);
+	}
+	for(; i < n; i++){
+		vec4_t p = vec4_load3(in[i]);
+		p.f[W] = (float)w;
+		vec4_store3(out[i], mat4_apply(m, p));
+	}
+}
+
+void vec3_normalize_n(vector *v, int n){
+	int i = 0;
+	__m128 half = _mm_set1_ps(0.5f), three = _mm_set1_ps(3.0f), zero = _mm_setzero_ps();
+	for(; i + 4 <= n; i += 4){
+		soa_t s = Load4(v + i);
+		__m128 l = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s.x, s.x), _mm_mul_ps(s.y, s.y)), _mm_mul_ps(s.z, s.z));
+		__m128 e = _mm_rsqrt_ps(l);
+		e = _mm_mul_ps(_mm_mul_ps(half, e), _mm_sub_ps(three, _mm_mul_ps(l, _mm_mul_ps(e, e))));
+		e = _mm_and_ps(e, _mm_cmpgt_ps(l, zero));	//zero length stays zero
+		s.x = _mm_mul_ps(s.x, e);
+		s.y = _mm_mul_ps(s.y, e);
+		s.z = _mm_mul_ps(s.z, e);
+		Store4(v + i, s);
+	}
+	for(; i < n; i++)
+		vec_normalize(v[i]);
+}
+
+#elif defined(VECMATH_NEON)
+
+static void Transform4(const mat4_t *m, vector *out, const vector *in, int n, int w){
+	int i = 0;
+	for(; i + 4 <= n; i += 4){
+		float32x4x3_t s = vld3q_f32(in[i]), d;
+		for(int r = 0; r < 3; r++){
+			float32x4_t v = vmulq_n_f32(s.val[0], M4(*m, r, 0));
+			v = vmlaq_n_f32(v, s.val[1], M4(*m, r, 1));
+			v = vmlaq_n_f32(v, s.val[2], M4(*m, r, 2));
+			d.val[r] = w ? vaddq_f32(v, vdupq_n_f32(M4(*m, r, 3))) : v;
+		}
+		vst3q_f32(out[i], d);
+	}
+	for(; i < n; i++){
+		vec4_t p = vec4_load3(in[i]);
+		p.f[W] = (float)w;
+		vec4_store3(out[i], mat4_apply(m, p));
+	}
+}
+
+void vec3_normalize_n(vector *v, int n){
+	int i = 0;
+	for(; i + 4 <= n; i += 4){
+		float32x4x3_t s = vld3q_f32(v[i]);
+		float32x4_t l = vmulq_f32(s.val[0], s.val[0]);
+		l = vmlaq_f32(l, s.val[1], s.val[1]);
+		l = vmlaq_f32(l, s.val[2], s.val[2]);
+		float32x4_t e = vrsqrteq_f32(l);
+		e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(l, e), e));
+		e = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(e), vcgtq_f32(l, vdupq_n_f32(0))));
+		for(int k = 0; k < 3; k++)
+			s.val[k] = vmulq_f32(s.val[k], e);
+		vst3q_f32(v[i], s);
+	}
+	for(; i < n; i++)
+		vec_normalize(v[i]);
+}
+
+#else
+
+static void Transform4(const mat4_t *m, vector *out, const vector *in, int n, int w){
+	for(int i = 0; i < n; i++){
+		float x = in[i][X], y = in[i][Y], z = in[i][Z];
+		for(int r = 0; r < 3; r++)
+			out[i][r] = M4(*m, r, 0) * x + M4(*m, r, 1) * y + M4(*m, r, 2) * z + (w ? M4(*m, r, 3) : 0.0f);
+	}
+}
+
+void vec3_normalize_n(vector *v, int n){
+	for(int i = 0; i < n; i++)
+		vec_normalize(v[i]);
+}
+
+#endif
+
+void vec3_transform_n(const mat4_t *m, vector *out, const vector *in, int n){
+	Transform4(m, out, in, n, 1);
+}
+
+void vec3_rotate_n(const mat4_t *m, vector *out, const vector *in, int n){
+	Transform4(m, out, in, n, 0);
+}
+
+/*	Broadcasts per point rather than SoA, the output already is a
+	vec4 per point.	*/
+void vec3_project_n(const mat4_t *m, float (*out)[4], const vector *in, int n){
+	for(int i = 0; i < n; i++){
+		vec4_t p = mat4_apply(m, vec4_set(in[i][X], in[i][Y], in[i][Z], 1.0f));
+#if defined(VECMATH_SSE)
+		_mm_store_ps(out[i], p.m);
+#elif defined(VECMATH_NEON)
+		vst1q_f32(out[i], p.m);
+#else
+		memcpy(out[i], p.f, sizeof(p.f));
+#endif
+	}
+}
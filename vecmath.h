@@ -0,0 +1,251 @@
+/*-
+ * SPDX-License-Identifier: BSD-0-Clause
+ *
+ * Copyright (c) 2026
+ *	Potr Dervyshev.  All rights reserved.
+ *	@(#)vecmath.h	1.0 (Potr Dervyshev) 17/10/2026
+ */
+
+#ifndef VECMATH_H_SENTRY
+#define VECMATH_H_SENTRY
+
+#include <math.h>
+
+/*	SSE on x86, NEON on ARM, plain C with -DVECMATH_SCALAR or
+	anywhere else. Results agree to the last bit or two: normalize
+	is a reciprocal square root estimate plus one Newton step.	*/
+#if !defined(VECMATH_SCALAR) && defined(__SSE__)
+#define VECMATH_SSE 1
+#include <xmmintrin.h>
+#elif !defined(VECMATH_SCALAR) && defined(__ARM_NEON)
+#define VECMATH_NEON 1
+#include <arm_neon.h>
+#endif
+
+/*-------------------------------------------------
+	#        1.PACKED VECTORS    #
+------------------------------------------------- */
+/*	The storage type of the mesh arrays, 12 bytes a point */
+
+enum {X = 0, Y = 1, Z = 2, W = 3};
+
+typedef float vector[3];
+
+#define VEC_ABS(v) ( sqrtf((v)[X]*(v)[X] + (v)[Y]*(v)[Y] + (v)[Z]*(v)[Z]) )
+
+static inline void vec_add(vector a, vector b, vector c){
+	c[X] = a[X] + b[X];
+	c[Y] = a[Y] + b[Y];
+	c[Z] = a[Z] + b[Z];
+};
+
+static inline void vec_sub(vector a, vector b, vector c){
+	c[X] = a[X] - b[X];
+	c[Y] = a[Y] - b[Y];
+	c[Z] = a[Z] - b[Z];
+};
+
+static inline void vec_scalar_mul(vector v, float k, vector u){
+	u[X] = v[X] * k;
+	u[Y] = v[Y] * k;
+	u[Z] = v[Z] * k;
+};
+
+static inline void vec_cross(vector a, vector b, vector c){
+	c[X] = a[Y]*b[Z] - a[Z]*b[Y];
+	c[Y] = a[Z]*b[X] - a[X]*b[Z];
+	c[Z] = a[X]*b[Y] - a[Y]*b[X];
+};
+
+static inline float vec_dot(vector a, vector b){
+	return a[X]*b[X] + a[Y]*b[Y] + a[Z]*b[Z];
+};
+
+/*-------------------------------------------------
+	#        2.ALIGNED VECTORS    #
+------------------------------------------------- */
+
+typedef union {
+	float f[4];
+#if defined(VECMATH_SSE)
+	__m128 m;
+#elif defined(VECMATH_NEON)
+	float32x4_t m;
+#endif
+} __attribute__((aligned(16))) vec4_t;
+
+static inline vec4_t vec4_set(float x, float y, float z, float w){
+	vec4_t r = {{x, y, z, w}};
+	return r;
+}
+
+static inline vec4_t vec4_load3(const float *p){	//w = 0
+	return vec4_set(p[X], p[Y], p[Z], 0.0f);
+}
+
+static inline void vec4_store3(float *p, vec4_t v){
+	p[X] = v.f[X];
+	p[Y] = v.f[Y];
+	p[Z] = v.f[Z];
+}
+
+static inline vec4_t vec4_splat(float k){
+	return vec4_set(k, k, k, k);
+}
+
+static inline vec4_t vec4_add(vec4_t a, vec4_t b){
+	vec4_t r;
+#if defined(VECMATH_SSE)
+	r.m = _mm_add_ps(a.m, b.m);
+#elif defined(VECMATH_NEON)
+	r.m = vaddq_f32(a.m, b.m);
+#else
+	for(int i = 0; i < 4; i++) r.f[i] = a.f[i] + b.f[i];
+#endif
+	return r;
+}
+
+static inline vec4_t vec4_sub(vec4_t a, vec4_t b){
+	vec4_t r;
+#if defined(VECMATH_SSE)
+	r.m = _mm_sub_ps(a.m, b.m);
+#elif defined(VECMATH_NEON)
+	r.m = vsubq_f32(a.m, b.m);
+#else
+	for(int i = 0; i < 4; i++) r.f[i] = a.f[i] - b.f[i];
+#endif
+	return r;
+}
+
+static inline vec4_t vec4_mul(vec4_t a, vec4_t b){
+	vec4_t r;
+#if defined(VECMATH_SSE)
+	r.m = _mm_mul_ps(a.m, b.m);
+#elif defined(VECMATH_NEON)
+	r.m = vmulq_f32(a.m, b.m);
+#else
+	for(int i = 0; i < 4; i++) r.f[i] = a.f[i] * b.f[i];
+#endif
+	return r;
+}
+
+static inline vec4_t vec4_min(vec4_t a, vec4_t b){
+	vec4_t r;
+#if defined(VECMATH_SSE)
+	r.m = _mm_min_ps(a.m, b.m);
+#elif defined(VECMATH_NEON)
+	r.m = vminq_f32(a.m, b.m);
+#else
+	for(int i = 0; i < 4; i++) r.f[i] = a.f[i] < b.f[i] ? a.f[i] : b.f[i];
+#endif
+	return r;
+}
+
+static inline vec4_t vec4_max(vec4_t a, vec4_t b){
+	vec4_t r;
+#if defined(VECMATH_SSE)
+	r.m = _mm_max_ps(a.m, b.m);
+#elif defined(VECMATH_NEON)
+	r.m = vmaxq_f32(a.m, b.m);
+#else
+	for(int i = 0; i < 4; i++) r.f[i] = a.f[i] > b.f[i] ? a.f[i] : b.f[i];
+#endif
+	return r;
+}
+
+static inline vec4_t vec4_scale(vec4_t v, float k){
+	return vec4_mul(v, vec4_splat(k));
+}
+
+//a*b + c
+static inline vec4_t vec4_madd(vec4_t a, vec4_t b, vec4_t c){
+	return vec4_add(vec4_mul(a, b), c);
+}
+
+static inline float vec4_dot3(vec4_t a, vec4_t b){
+	vec4_t p = vec4_mul(a, b);
+	return p.f[X] + p.f[Y] + p.f[Z];
+}
+
+static inline vec4_t vec4_cross3(vec4_t a, vec4_t b){
+#if defined(VECMATH_SSE)
+	vec4_t r;
+	__m128 a1 = _mm_shuffle_ps(a.m, a.m, _MM_SHUFFLE(3, 0, 2, 1));	//y z x
+	__m128 b1 = _mm_shuffle_ps(b.m, b.m, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 c = _mm_sub_ps(_mm_mul_ps(a.m, b1), _mm_mul_ps(a1, b.m));
+	r.m = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+	return r;
+#else
+	return vec4_set(a.f[Y] * b.f[Z] - a.f[Z] * b.f[Y], a.f[Z] * b.f[X] - a.f[X] * b.f[Z],
+		a.f[X] * b.f[Y] - a.f[Y] * b.f[X], 0.0f);
+#endif
+}
+
+//1/sqrt(x), 0 for x == 0
+static inline float vec_rsqrt(float x){
+#if defined(VECMATH_SSE)
+	float e = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+	return x > 0 ? e * (1.5f - 0.5f * x * e * e) : 0.0f;
+#elif defined(VECMATH_NEON)
+	float e = vget_lane_f32(vrsqrte_f32(vdup_n_f32(x)), 0);
+	e *= vget_lane_f32(vrsqrts_f32(vdup_n_f32(x * e), vdup_n_f32(e)), 0);
+	return x > 0 ? e : 0.0f;
+#else
+	return x > 0 ? 1.0f / sqrtf(x) : 0.0f;
+#endif
+}
+
+static inline float vec4_length3(vec4_t v){
+	return sqrtf(vec4_dot3(v, v));
+}
+
+static inline vec4_t vec4_normalize3(vec4_t v){	//zero stays zero
+	return vec4_scale(v, vec_rsqrt(vec4_dot3(v, v)));
+}
+
+static inline void vec_normalize(vector v){
+	vec4_store3(v, vec4_normalize3(vec4_load3(v)));
+}
+
+/*-------------------------------------------------
+	#        3.MATRICES    #
+------------------------------------------------- */
+/*	Column-major, points are columns: p' = M p, so mat4_mul(a, b)
+	applies b first. Left-handed: the camera looks along +Z, Y is up. */
+
+typedef struct {
+	vec4_t c[4];
+} mat4_t;
+
+#define M4(mat,row,col) ((mat).c[(col)].f[(row)])
+
+//M p with p = (x, y, z, w)
+static inline vec4_t mat4_apply(const mat4_t *m, vec4_t p){
+	vec4_t r = vec4_mul(m->c[0], vec4_splat(p.f[X]));
+	r = vec4_madd(m->c[1], vec4_splat(p.f[Y]), r);
+	r = vec4_madd(m->c[2], vec4_splat(p.f[Z]), r);
+	return vec4_madd(m->c[3], vec4_splat(p.f[W]), r);
+}
+
+mat4_t mat4_identity(void);
+mat4_t mat4_mul(const mat4_t *a, const mat4_t *b);
+mat4_t mat4_translate(float dx, float dy, float dz);
+mat4_t mat4_scale(float sx, float sy, float sz);
+mat4_t mat4_rotate(float alpha, float beta, float gamma);	//the rotation of TurnWavefront
+mat4_t mat4_perspective(float fov, float aspect, float znear, float zfar);	//w = view z
+mat4_t mat4_normal(const mat4_t *m);	//for directions: inverse-transpose of the 3x3 part, up to scale
+int mat4_inverse_affine(const mat4_t *m, mat4_t *out);	//bottom row 0 0 0 1; 0 - ok, -1 - singular
+
+/*-------------------------------------------------
+	#        4.BATCHES    #
+------------------------------------------------- */
+/*	Over packed vector arrays: 4 points are loaded as 3 registers
+	and shuffled to x, y, z lanes (SoA), the tail goes one by one.
+	in and out may be the same array.	*/
+
+void vec3_transform_n(const mat4_t *m, vector *out, const vector *in, int n);	//points, w = 1
+void vec3_rotate_n(const mat4_t *m, vector *out, const vector *in, int n);	//directions, w = 0
+void vec3_project_n(const mat4_t *m, float (*out)[4], const vector *in, int n);	//to x y z w, out 16-byte aligned
+void vec3_normalize_n(vector *v, int n);
+
+#endif
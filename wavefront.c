@@ -7,63 +7,24 @@
  */
  
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <time.h>
 #include "wavefront.h"
-
-/*------------------------------------------------- 
-	#        Polygon Stack (static)      #
-------------------------------------------------- */
-
-static polygon_t *PushPolyPoint(polygon_t **top, const int v, const int vt, const int vn){
-	polygon_t *new_node = malloc(sizeof(polygon_t));
-	new_node->v = v;
-	new_node->vt = vt;
-	new_node->vn = vn;
-	new_node->next = *top;
-	*top = new_node;
-#ifdef DEBUG
-	printf("(dbg) wavefront.c: POINT ADDED TO THE POLY: v=%i, vt=%i, vn=%i\n", v, vt, vn);
-#endif
-	return new_node;
-}
-
-static void DelPolyPoint(polygon_t **list, int v){
-	while(*list){
-		if((*list)->v == v){
-			polygon_t *target = *list;
-			*list = (*list)->next;
-			free(target);
-			return;
-		}
-		else {
-			list = &(*list)->next;
-		};
-	}
-}
-
-static polygon_t *PopPolyPoint(polygon_t **top) {
-	if (*top == NULL) 
-		return NULL;
-	polygon_t *res = *top;
-	*top = (*top)->next;
-	return res;
-}
-
-static void RemovePoly(polygon_t *list){
-	while(list) {
-		polygon_t *tmp = list;
-		list = list->next;
-		free(tmp);
-	}
-}
+#include "bench.h"
 
 /*------------------------------------------------- 
 	#        Utility (static)      #
 ------------------------------------------------- */
 
-static char *FileToBuffer(const char path[]) {
+static char *FileToBuffer(const char path[], size_t *len) {
 	FILE *file = fopen(path, "rb");
 	if (!file) return NULL;
 	if (fseek(file, 0, SEEK_END) != 0) {
@@ -84,39 +45,197 @@ static char *FileToBuffer(const char path[]) {
 	size_t read_bytes = fread(result, 1, (size_t)length, file);
 	fclose(file);
 	result[read_bytes] = '\0';
+	*len = read_bytes;
 	return result;
 }
 
-static wavefront_t *InitWavefront(int vc, int vtc, int vnc, int fc){
-	if(vc == 0)
+static const char *MapFile(const char path[], size_t *len) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return NULL;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
 		return NULL;
-	wavefront_t *result = malloc(sizeof(wavefront_t));
-	result->vertex = malloc((sizeof(float *)) * (vc + 1));
-	for(int v = 0; v < vc; v++){
-		(result->vertex)[v] = (float *)malloc(3 * sizeof(float));
-	};
-	(result->vertex)[vc] = NULL;
-	result->texture = NULL;
-	if(vtc != 0){
-		result->texture = malloc((sizeof(float *)) * (vtc +1));
-		for(int vt = 0; vt < vtc; vt++){
-			(result->texture)[vt] = (float *)malloc(3 * sizeof(float));
-		};
-		(result->texture)[vtc] = NULL;
 	}
-	result->normal = NULL;
-	if(vnc != 0){
-		result->normal = malloc((sizeof(float *)) * (vnc +1));
-		for(int vn = 0; vn < vnc; vn++){
-			(result->normal)[vn] = (float *)malloc(3 * sizeof(float));
-		};
-		(result->normal)[vnc] = NULL;
-	}	
-	result->face = malloc(sizeof(polygon_t *) * (fc + 1));
-	for(int i = 0; i <= fc; i++){
-		result->face[i] = NULL;
-	};
-	return result;
+	void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);	//mapping keeps the file referenced
+	if (map == MAP_FAILED) return NULL;
+	madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+	*len = (size_t)st.st_size;
+	return map;
+}
+
+/*	arr itself or its new place; NULL - out of memory, arr and *cap
+	are left as they were */
+static void *Grow(void *arr, int *cap, int need, size_t size){
+	if(need <= *cap)
+		return arr;
+	int newcap = *cap ? *cap : 64;
+	while(newcap < need)
+		newcap *= 2;
+	void *grown = realloc(arr, size * newcap);
+	if(grown != NULL)
+		*cap = newcap;
+	return grown;
+}
+
+/*------------------------------------------------- 
+	#        Arena (static)      #
+------------------------------------------------- */
+/*	Every byte of a mesh (the wavefront_t itself included) comes
+	from a short chain of blocks, so RemoveWavefront frees a few
+	blocks no matter how big the mesh is.	*/
+
+#define ARENA_ALIGN 64
+#define ARENA_BLOCK (64 << 10)	//min size of blocks added later
+
+struct wavefront_block {
+	wavefront_block_t *next;
+	size_t size, used;	//bytes after the header
+};
+
+static void *DefaultAlloc(size_t size, void *user){
+	return malloc(size);
+}
+
+static void DefaultFree(void *ptr, size_t size, void *user){
+	free(ptr);
+}
+
+static wavefront_allocator_t Allocator = {DefaultAlloc, DefaultFree, NULL};
+
+static wavefront_block_t *NewBlock(wavefront_allocator_t *a, size_t size){
+	size += ARENA_ALIGN;
+	wavefront_block_t *b = a->Alloc(sizeof(wavefront_block_t) + size, a->user);
+	if(b == NULL)
+		return NULL;
+	b->next = NULL;
+	b->size = size;
+	b->used = 0;
+	return b;
+}
+
+static void *BlockAlloc(wavefront_block_t *b, size_t size){
+	uintptr_t base = (uintptr_t)(b + 1);
+	uintptr_t p = (base + b->used + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1);
+	if(p + size > base + b->size)
+		return NULL;
+	b->used = p + size - base;
+	return (void *)p;
+}
+
+static void *ArenaAlloc(wavefront_t *obj, size_t size){
+	void *p = BlockAlloc(obj->arena, size);
+	if(p == NULL){
+		wavefront_block_t *b = NewBlock(&obj->alloc, size > ARENA_BLOCK ? size : ARENA_BLOCK);
+		if(b == NULL)
+			return NULL;
+		b->next = obj->arena;
+		obj->arena = b;
+		p = BlockAlloc(b, size);
+	}
+	return p;
+}
+
+/*	payload - bytes the caller is going to ArenaAlloc() in at most
+	"arrays" pieces, they all fit in the first block */
+static wavefront_t *NewWavefront(size_t payload, int arrays){
+	wavefront_allocator_t a = Allocator;
+	wavefront_block_t *b = NewBlock(&a, sizeof(wavefront_t) + payload + ARENA_ALIGN * arrays);
+	if(b == NULL)
+		return NULL;
+	wavefront_t *obj = BlockAlloc(b, sizeof(wavefront_t));
+	memset(obj, 0, sizeof(wavefront_t));
+	obj->arena = b;
+	obj->alloc = a;
+	return obj;
+}
+
+static void ReleaseArena(wavefront_allocator_t a, wavefront_block_t *b){
+	while(b){
+		wavefront_block_t *next = b->next;
+		a.Free(b, sizeof(wavefront_block_t) + b->size, a.user);
+		b = next;
+	}
+}
+
+/*------------------------------------------------- 
+	#     Number Scanner (static)      #
+------------------------------------------------- */
+/*	Locale-independent replacements for strtof/atoi working
+	inside [p, end) without copying the line. Each one skips
+	leading blanks and returns the position after the token.	*/
+
+#define IS_BLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\r')
+#define IS_DIGIT(c) ((unsigned)((c) - '0') < 10)
+
+static const double Pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const char *SkipBlanks(const char *p, const char *end){
+	while(p < end && IS_BLANK(*p))
+		p++;
+	return p;
+}
+
+static const char *SkipToken(const char *p, const char *end){
+	while(p < end && !IS_BLANK(*p))
+		p++;
+	return p;
+}
+
+static const char *ScanFloat(const char *p, const char *end, float *out){
+	unsigned long long m = 0;
+	int digits = 0, seen = 0, exp10 = 0, neg = 0;
+	if(p < end && (*p == '-' || *p == '+'))
+		neg = (*p++ == '-');
+	for(; p < end && IS_DIGIT(*p); p++, seen = 1){
+		if(digits < 19){
+			m = m * 10 + (*p - '0');
+			if(m) digits++;
+		}
+		else exp10++;
+	}
+	if(p < end && *p == '.'){
+		for(p++; p < end && IS_DIGIT(*p); p++, seen = 1){
+			if(digits < 19){
+				m = m * 10 + (*p - '0');
+				if(m) digits++;
+				exp10--;
+			}
+		}
+	}
+	if(seen && p < end && (*p == 'e' || *p == 'E')){
+		const char *q = p + 1;
+		int eneg = 0, e = 0;
+		if(q < end && (*q == '-' || *q == '+'))
+			eneg = (*q++ == '-');
+		if(q < end && IS_DIGIT(*q)){
+			for(; q < end && IS_DIGIT(*q); q++)
+				if(e < 10000) e = e * 10 + (*q - '0');
+			exp10 += eneg ? -e : e;
+			p = q;
+		}
+	}
+	double d = (double)m;
+	if(m < (1ULL << 53) && exp10 >= -22 && exp10 <= 22)	//exact in double
+		d = exp10 < 0 ? d / Pow10[-exp10] : d * Pow10[exp10];
+	else if(m != 0)
+		d = d * pow(10.0, exp10);
+	*out = (float)(neg ? -d : d);	//no digits gives 0, like strtof
+	return SkipToken(p, end);	//trailing junk of the token is ignored
+}
+
+static const char *ScanInt(const char *p, const char *end, int *out){
+	int neg = 0, n = 0;
+	if(p < end && (*p == '-' || *p == '+'))
+		neg = (*p++ == '-');
+	for(; p < end && IS_DIGIT(*p); p++)
+		n = n * 10 + (*p - '0');
+	*out = neg ? -n : n;
+	return p;
 }
 
 /*------------------------------------------------- 
@@ -135,6 +254,7 @@ typedef enum parser_states {
 
 typedef struct parser parser_t;
 
+/*	line points right after the keyword ("v", "vt", ...) */
 typedef void (*Handler_t)(const char *line, int line_len, void *userdata, parser_t *this);
 
 struct parser {
@@ -143,213 +263,659 @@ struct parser {
 	void *userdata;
 };
 
-static void ParseObj(const char *input, parser_t *p) {
-	int start = 0;
-	for (int i = 0; input[i] != '\0'; i++) {
-		char c = input[i];
-		if (c == '\n') {
-			int len = i - start;
-			if (len > 0) {
-				if (p->state < MAX_STATES && p->Handle[p->state]) {
-					p->Handle[p->state](input + start, len, p->userdata, p);
-				}
+static void ParseObj(const char *input, size_t len, parser_t *p) {
+	const char *end = input + len;
+	while (input < end) {
+		const char *eol = memchr(input, '\n', end - input);
+		if (eol == NULL)
+			eol = end;
+		const char *c = SkipBlanks(input, eol);
+		p->state = ST_UNDEFINED;
+		if (eol - c >= 2 && IS_BLANK(c[1])) {
+			if (c[0] == 'v') p->state = ST_V;
+			else if (c[0] == 'f') p->state = ST_F;
+			c += 1;
+		}
+		else if (eol - c >= 3 && c[0] == 'v' && IS_BLANK(c[2])) {
+			if (c[1] == 't') p->state = ST_VT;
+			else if (c[1] == 'n') p->state = ST_VN;
+			c += 2;
+		}
+		else if (c < eol && c[0] == '#')
+			p->state = ST_COMMENT;
+		if (p->Handle[p->state])
+			p->Handle[p->state](c, eol - c, p->userdata, p);
+		input = eol + 1;
+	}
+}
+
+/*	Growable mesh under construction. Single pass: every handler
+	appends to its array, counters double as relative-index bases */
+typedef struct {
+	int vc, vtc, vnc, fc, pc;
+	int vcap, vtcap, vncap, fcap, pcap;
+	vector *vertex;
+	vector *texture;
+	vector *normal;
+	polygon_t *index;
+	int *face;
+	int chunked;	//parsing a piece of the file, see BuildWavefront()
+	int nfix, fixcap;
+	int *fix;	//(point, kind) pairs of relative indices
+	int failed;	//out of memory, the rest of the chunk is skipped
+} builder_t;
+
+static int PushVector(const char *line, int len, vector **arr, int *count, int *cap){
+	const char *p = line, *end = line + len;
+	vector *grown = Grow(*arr, cap, *count + 1, sizeof(vector));
+	if(grown == NULL)
+		return -1;
+	*arr = grown;
+	float *v = (*arr)[(*count)++];
+	int i = 0;
+	for(p = SkipBlanks(p, end); p < end && i < 3; p = SkipBlanks(p, end))
+		p = ScanFloat(p, end, &v[i++]);
+	while(i < 3)	//optional w is dropped, missing ones are zero
+		v[i++] = 0.0f;
+	return 0;
+}
+
+static void PushVertex(const char *line, int len, void *data, parser_t *this) {
+	builder_t *b = data;
+	if(!b->failed && PushVector(line, len, &b->vertex, &b->vc, &b->vcap) != 0)
+		b->failed = 1;
+}
+
+static void PushTexCoord(const char *line, int len, void *data, parser_t *this) {
+	builder_t *b = data;
+	if(!b->failed && PushVector(line, len, &b->texture, &b->vtc, &b->vtcap) != 0)
+		b->failed = 1;
+}
+
+static void PushNormal(const char *line, int len, void *data, parser_t *this) {
+	builder_t *b = data;
+	if(!b->failed && PushVector(line, len, &b->normal, &b->vnc, &b->vncap) != 0)
+		b->failed = 1;
+}
+
+/*	In a chunk relative indices are resolved against the local
+	counters and remembered, the chunk base is added on merge */
+static int Relative(builder_t *b, int count, int idx, int kind){
+	if(b->chunked){
+		int *grown = Grow(b->fix, &b->fixcap, b->nfix + 2, sizeof(int));
+		if(grown == NULL){
+			b->failed = 1;
+			return 0;
+		}
+		b->fix = grown;
+		b->fix[b->nfix++] = b->pc;
+		b->fix[b->nfix++] = kind;
+	}
+	return count + idx + 1;
+}
+
+static void PushFace(const char *line, int len, void *data, parser_t *this) {
+	builder_t *b = data;
+	const char *p = line, *end = line + len;
+	int *face = b->failed ? NULL : Grow(b->face, &b->fcap, b->fc + 2, sizeof(int));
+	if(face == NULL){
+		b->failed = 1;
+		return;
+	}
+	b->face = face;
+	if(b->fc == 0)
+		b->face[0] = 0;
+	for(p = SkipBlanks(p, end); p < end; p = SkipBlanks(SkipToken(p, end), end)){
+		int v=0, vt=0, vn=0;
+		p = ScanInt(p, end, &v);
+		if (p < end && *p == '/') {
+			p = ScanInt(p + 1, end, &vt);
+			if (p < end && *p == '/')
+				p = ScanInt(p + 1, end, &vn);
+		}
+		if (v == 0)
+			continue;
+		if (v  < 0) v  = Relative(b, b->vc, v, ST_V);
+		if (vt < 0) vt = Relative(b, b->vtc, vt, ST_VT);
+		if (vn < 0) vn = Relative(b, b->vnc, vn, ST_VN);
+		if (b->failed)
+			return;
+		if (v != 0 || b->chunked) {
+			polygon_t *grown = Grow(b->index, &b->pcap, b->pc + 1, sizeof(polygon_t));
+			if (grown == NULL) {
+				b->failed = 1;
+				return;
 			}
-			p->state = ST_UNDEFINED;
-			start = i + 1;
-		}
-		else if (p->state == ST_UNDEFINED) {
-			if (c == '#') p->state = ST_COMMENT;
-			else if (c == 'v') {
-				if (input[i+1] == 't') { p->state = ST_VT; i++; }
-				else if (input[i+1] == 'n') { p->state = ST_VN; i++; }
-				else if (input[i+1] == ' ') { p->state = ST_V; }
+			b->index = grown;
+			b->index[b->pc].v = v;
+			b->index[b->pc].vt = vt;
+			b->index[b->pc].vn = vn;
+			b->pc++;
+		}
+	}
+	b->face[++b->fc] = b->pc;
+}
+
+/*------------------------------------------------- 
+	#     Triangulation (static)      #
+------------------------------------------------- */
+/*	Faces are cut once at load into obj->tri. Convex ones are fanned
+	from their first point, concave ones ear clipped in the plane of
+	their Newell normal; triangles with no area (faces of less than
+	3 points, repeated or collinear points) are dropped.	*/
+
+#define TRI_FLAT 1e-12f	//sin^2 of the sharpest angle still a triangle
+
+typedef struct {
+	float (*p)[2];	//the face projected on its plane
+	int *next, *prev;
+	int cap;
+} ring_t;
+
+static inline int HasArea(const wavefront_t *obj, int a, int b, int c){
+	vec4_t p = vec4_load3(obj->vertex[obj->index[a].v - 1]);
+	vec4_t u = vec4_sub(vec4_load3(obj->vertex[obj->index[b].v - 1]), p);
+	vec4_t v = vec4_sub(vec4_load3(obj->vertex[obj->index[c].v - 1]), p);
+	vec4_t n = vec4_cross3(u, v);
+	return vec4_dot3(n, n) > TRI_FLAT * vec4_dot3(u, u) * vec4_dot3(v, v);
+}
+
+static inline float Cross2(const float *a, const float *b, const float *c){
+	return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+//b is an ear: a convex corner with no other point of the ring inside
+static int IsEar(const ring_t *r, int a, int b, int c, float s){
+	if(Cross2(r->p[a], r->p[b], r->p[c]) * s <= 0.0f)
+		return 0;
+	for(int i = r->next[c]; i != a; i = r->next[i])
+		if(Cross2(r->p[a], r->p[b], r->p[i]) * s > 0.0f && Cross2(r->p[b], r->p[c], r->p[i]) * s > 0.0f &&
+				Cross2(r->p[c], r->p[a], r->p[i]) * s > 0.0f)
+			return 0;
+	return 1;
+}
+
+/*	Writes the triangles of face f as point numbers (into index[]),
+	at most FACE_SIZE - 2 of them; returns how many. -1 - no memory */
+static int TriangulateFace(const wavefront_t *obj, int f, int *out, ring_t *r){
+	int first = obj->face[f], n = FACE_SIZE(obj, f), k = 0;
+	if(n < 3)
+		return 0;
+	vec4_t nrm = vec4_splat(0.0f);	//Newell: sum of (p_i - p_0) x (p_i+1 - p_0)
+	vec4_t p0 = vec4_load3(obj->vertex[obj->index[first].v - 1]);
+	vec4_t u = vec4_sub(vec4_load3(obj->vertex[obj->index[first + 1].v - 1]), p0);
+	for(int i = 2; i < n; i++){
+		vec4_t v = vec4_sub(vec4_load3(obj->vertex[obj->index[first + i].v - 1]), p0);
+		nrm = vec4_add(nrm, vec4_cross3(u, v));
+		u = v;
+	}
+	int axis = fabsf(nrm.f[X]) > fabsf(nrm.f[Y]) ? X : Y;
+	axis = fabsf(nrm.f[Z]) > fabsf(nrm.f[axis]) ? Z : axis;
+	if(n == 3 || nrm.f[axis] == 0.0f){	//triangle, or no plane to clip in
+		for(int i = 2; i < n; i++)
+			if(HasArea(obj, first, first + i - 1, first + i)){
+				out[k++] = first;
+				out[k++] = first + i - 1;
+				out[k++] = first + i;
+			}
+		return k / 3;
+	}
+	if(n > r->cap){
+		free(r->p);
+		r->p = malloc((sizeof(float[2]) + 2 * sizeof(int)) * n);
+		r->cap = r->p ? n : 0;
+		if(r->p == NULL)
+			return -1;
+		r->next = (int *)(r->p + n);
+		r->prev = r->next + n;
+	}
+	int ua = (axis + 1) % 3, va = (axis + 2) % 3;	//area there has the sign of nrm[axis]
+	float s = nrm.f[axis] > 0.0f ? 1.0f : -1.0f;
+	int convex = 1;
+	for(int i = 0; i < n; i++){
+		const float *p = obj->vertex[obj->index[first + i].v - 1];
+		r->p[i][0] = p[ua];
+		r->p[i][1] = p[va];
+		r->next[i] = (i + 1) % n;
+		r->prev[i] = (i + n - 1) % n;
+	}
+	for(int i = 0; i < n && convex; i++)
+		convex = Cross2(r->p[r->prev[i]], r->p[i], r->p[r->next[i]]) * s >= 0.0f;
+	int i = 0, left = n;
+	if(!convex)
+		for(int miss = 0; left > 3 && miss < left; ){
+			int a = r->prev[i], c = r->next[i];
+			if(!IsEar(r, a, i, c, s)){
+				i = c;
+				miss++;
+				continue;
 			}
-			else if (c == 'f' && input[i+1] == ' ') p->state = ST_F;
+			if(HasArea(obj, first + a, first + i, first + c)){
+				out[k++] = first + a;
+				out[k++] = first + i;
+				out[k++] = first + c;
+			}
+			r->next[a] = c;
+			r->prev[c] = a;
+			left--;
+			miss = 0;
+			i = c;
+		}
+	for(int j = r->next[r->next[i]]; j != i; j = r->next[j])	//convex, or what clipping left
+		if(HasArea(obj, first + i, first + r->prev[j], first + j)){
+			out[k++] = first + i;
+			out[k++] = first + r->prev[j];
+			out[k++] = first + j;
+		}
+	return k / 3;
+}
+
+/*	Fills obj->tri and obj->tface from the arena. 0 - ok, -1 - no memory */
+static int TriangulateWavefront(wavefront_t *obj){
+	int bound = 0, big = 0;
+	for(int f = 0; f < obj->fc; f++)
+		if(FACE_SIZE(obj, f) > 2){
+			bound += FACE_SIZE(obj, f) - 2;
+			if(FACE_SIZE(obj, f) - 2 > big)
+				big = FACE_SIZE(obj, f) - 2;
+		}
+	uint32_t *tri = ArenaAlloc(obj, sizeof(uint32_t) * 3 * (bound ? bound : 1));
+	int *tface = ArenaAlloc(obj, sizeof(int) * (bound ? bound : 1));
+	int *pts = malloc(sizeof(int) * 3 * (big ? big : 1));
+	ring_t ring = {NULL, NULL, NULL, 0};
+	int tc = 0, ok = tri && tface && pts;
+	for(int f = 0; f < obj->fc && ok; f++){
+		int n = TriangulateFace(obj, f, pts, &ring);
+		ok = n >= 0;
+		for(int t = 0; t < n; t++, tc++){
+			for(int k = 0; k < 3; k++)
+				tri[3 * tc + k] = obj->index[pts[3 * t + k]].v - 1;
+			tface[tc] = f;
+		}
+	}
+	free(pts);
+	free(ring.p);
+	if(!ok){
+		fprintf(stderr," (err) wavefront.c: Can't triangulate, out of memory\n");
+		return -1;
+	}
+	obj->tri = tri;
+	obj->tface = tface;
+	obj->tc = tc;
+	return 0;
+}
+
+/*------------------------------------------------- 
+	#     Chunked Parallel Parsing (static)      #
+------------------------------------------------- */
+
+#define CHUNK_MIN (1 << 20)	//don't spawn a thread for less than 1MB
+
+static int Threads = 0;	//0 - one per online CPU
+
+typedef struct {
+	const char *buf;
+	size_t len;
+	builder_t b;
+} chunk_t;
+
+static void *ParseChunk(void *arg){
+	chunk_t *ch = arg;
+	parser_t Run = {ST_UNDEFINED,{NULL,PushVertex,PushTexCoord,PushNormal,PushFace,NULL},&ch->b};
+	ParseObj(ch->buf, ch->len, &Run);
+	return NULL;
+}
+
+/*	Points whose relative v turned out to be 0 are dropped,
+	the same as the serial parser does */
+static void DropEmptyPoints(builder_t *b){
+	int p = 0, start = 0;
+	for(int f = 0; f < b->fc; f++){
+		int end = b->face[f + 1];
+		for(int i = start; i < end; i++)
+			if(b->index[i].v != 0)
+				b->index[p++] = b->index[i];
+		start = end;
+		b->face[f + 1] = p;
+	}
+	b->pc = p;
+}
+
+/*	Adds the chunk bases to the recorded relative indices */
+static void FixupChunk(builder_t *b, int vbase, int vtbase, int vnbase){
+	int empty = 0;
+	for(int i = 0; i < b->nfix; i += 2){
+		polygon_t *pt = &b->index[b->fix[i]];
+		switch(b->fix[i + 1]){
+		case ST_V:  pt->v += vbase; empty |= (pt->v == 0); break;
+		case ST_VT: pt->vt += vtbase; break;
+		case ST_VN: pt->vn += vnbase; break;
 		}
 	}
+	if(empty)
+		DropEmptyPoints(b);
 }
 
-void Count(const char *line, int line_len, void *out,parser_t *this){
-	int *count_res = (int *)out;
-	count_res[this->state]++;
+/*	Faces with a point outside the arrays (a number past the end, or
+	a relative one reaching before the start) are dropped whole, in
+	place, before anything reads through them.	*/
+static int DropBadFaces(wavefront_t *obj){
+	int p = 0, start = 0, kept = 0;
+	for(int f = 0; f < obj->fc; f++){
+		int end = obj->face[f + 1], ok = 1;
+		for(int i = start; i < end && ok; i++){
+			const polygon_t *pt = &obj->index[i];
+			ok = pt->v >= 1 && pt->v <= obj->vc && pt->vt >= 0 && pt->vt <= obj->vtc &&
+				pt->vn >= 0 && pt->vn <= obj->vnc;
+		}
+		if(ok){
+			memmove(obj->index + p, obj->index + start, sizeof(polygon_t) * (end - start));
+			p += end - start;
+			obj->face[++kept] = p;
+		}
+		start = end;
+	}
+	int dropped = obj->fc - kept;
+	obj->fc = kept;
+	return dropped;
 }
 
-void AddVertex(const char *line, int len, void *data, parser_t *this) {
-	void **tmp = (void **)data;
-	wavefront_t *obj = (wavefront_t*)tmp[0];
-	int *counters = (int*)tmp[1];
-	int *idx = &counters[ST_V];
-	float *v = obj->vertex[*idx];
-	char buf[len+1];
-	memcpy(buf, line+1, len-1);
-	buf[len-1] = '\0';
-	char *token = strtok(buf, " \t");
-	int i = 0;
-	while (token && i < 4) {
-		v[i++] = strtof(token, NULL);
-		token = strtok(NULL, " \t");
-	}
-	if (i == 3) v[3] = 1.0f;
-	(*idx)++;
-}
-
-void AddNormal(const char *line, int len, void *data, parser_t *this) {
-	void **tmp = (void **)data;
-	wavefront_t *obj = (wavefront_t*)tmp[0];
-	int *counters = (int*)tmp[1];
-	int *idx = &counters[ST_VN];
-	float *n = obj->normal[*idx];
-	char buf[len+1];
-	memcpy(buf, line+2, len-2); // "vn " уже скипаем
-	buf[len-2] = '\0';
-	char *token = strtok(buf, " \t");
-	int i = 0;
-	while (token && i < 3) {
-		n[i++] = strtof(token, NULL);
-		token = strtok(NULL, " \t");
-	}
-	(*idx)++;
-}
-
-void AddTexCoord(const char *line, int len, void *data, parser_t *this) {
-	void **tmp = (void **)data;
-	wavefront_t *obj = (wavefront_t*)tmp[0];
-	int *counters = (int*)tmp[1];
-	int *idx = &counters[ST_VT];
-	float *t = obj->texture[*idx];
-	char buf[len+1];
-	memcpy(buf, line+2, len-2); // "vt "
-	buf[len-2] = '\0';
-	char *token = strtok(buf, " \t");
-	int i = 0;
-	while (token && i < 3) {
-		t[i++] = strtof(token, NULL);
-		token = strtok(NULL, " \t");
-	}
-	if (i == 2) t[2] = 0.0f;
-	(*idx)++;
-}
-
-void AddFace(const char *line, int len, void *data, parser_t *this) {
-	void **tmp = (void **)data;
-	wavefront_t *obj = (wavefront_t*)tmp[0];
-	int *counters = (int*)tmp[1];
-	int *fidx = &counters[ST_F];
-	char buf[len+1];
-	memcpy(buf, line+1, len-1);
-	buf[len-1] = '\0';
-	char *token = strtok(buf, " \t");
-	while (token) {
-		int v=0, vt=0, vn=0;
-		char *s1 = token;
-		char *s2 = strchr(s1, '/');
-		if (s2) { *s2 = '\0'; s2++; }
-		char *s3 = s2 ? strchr(s2, '/') : NULL;
-		if (s3) { *s3 = '\0'; s3++; }
-		if (*s1) v  = atoi(s1);
-		if (s2 && *s2) vt = atoi(s2);
-		if (s3 && *s3) vn = atoi(s3);
-		if (v  < 0) v  = counters[ST_V]  + v + 1;
-		if (vt < 0) vt = counters[ST_VT] + vt + 1;
-		if (vn < 0) vn = counters[ST_VN] + vn + 1;
-		if (v != 0)
-			PushPolyPoint(&obj->face[*fidx], v, vt, vn);
-		token = strtok(NULL, " \t");
-	}
-	(*fidx)++;
+static void FreeBuilder(builder_t *b){
+	free(b->vertex);
+	free(b->texture);
+	free(b->normal);
+	free(b->index);
+	free(b->face);
+	free(b->fix);
+}
+
+/*	Copies the chunks, in file order, into the arena of a new mesh
+	and frees them */
+static wavefront_t *BuildWavefront(chunk_t *ch, int n){
+	int vc = 0, vtc = 0, vnc = 0, fc = 0, pc = 0, failed = 0;
+	for(int k = 0; k < n; k++)
+		failed |= ch[k].b.failed;
+	if(failed){
+		fprintf(stderr," (err) wavefront.c: Out of memory while parsing\n");
+		for(int k = 0; k < n; k++)
+			FreeBuilder(&ch[k].b);
+		return NULL;
+	}
+	for(int k = 0; k < n; k++){
+		FixupChunk(&ch[k].b, vc, vtc, vnc);
+		vc += ch[k].b.vc; vtc += ch[k].b.vtc; vnc += ch[k].b.vnc;
+		fc += ch[k].b.fc; pc += ch[k].b.pc;
+	}
+	wavefront_t *result = NULL;
+	if(vc != 0)
+		result = NewWavefront(sizeof(vector) * (vc + vtc + vnc) +
+			sizeof(polygon_t) * pc + sizeof(int) * (fc + 1), 5);
+	if(result != NULL){
+		result->vertex = ArenaAlloc(result, sizeof(vector) * vc);
+		result->texture = vtc ? ArenaAlloc(result, sizeof(vector) * vtc) : NULL;
+		result->normal = vnc ? ArenaAlloc(result, sizeof(vector) * vnc) : NULL;
+		result->index = ArenaAlloc(result, sizeof(polygon_t) * pc);
+		result->face = ArenaAlloc(result, sizeof(int) * (fc + 1));
+		result->face[0] = 0;
+	}
+	for(int k = 0; k < n; k++){
+		builder_t *src = &ch[k].b;
+		if(result != NULL){
+			wavefront_t *dst = result;
+			int p = dst->face[dst->fc];
+			memcpy(dst->vertex + dst->vc, src->vertex, sizeof(vector) * src->vc);
+			memcpy(dst->texture + dst->vtc, src->texture, sizeof(vector) * src->vtc);
+			memcpy(dst->normal + dst->vnc, src->normal, sizeof(vector) * src->vnc);
+			memcpy(dst->index + p, src->index, sizeof(polygon_t) * src->pc);
+			for(int f = 1; f <= src->fc; f++)
+				dst->face[dst->fc + f] = src->face[f] + p;
+			dst->vc += src->vc; dst->vtc += src->vtc; dst->vnc += src->vnc;
+			dst->fc += src->fc;
+		}
+		FreeBuilder(src);
+	}
+	int bad = result != NULL ? DropBadFaces(result) : 0;
+	if(bad)
+		fprintf(stderr," (err) wavefront.c: %i faces point past the vertex lists, dropped\n", bad);
+	if(result != NULL && TriangulateWavefront(result) != 0){
+		RemoveWavefront(result);
+		result = NULL;
+	}
+	if(result != NULL)
+		WavefrontCalculateBounds(result);
+	return result;
+}
+
+/*------------------------------------------------- 
+	#     Binary Cache (static)      #
+------------------------------------------------- */
+/*	File = header + vertex, texture, normal, index, face, tri and
+	tface arrays, each one starting on a CACHE_ALIGN boundary. Written in host
+	byte order; a foreign or old file is rejected and rebuilt.	*/
+
+#define CACHE_MAGIC "CRWF"
+#define CACHE_VERSION 2
+#define CACHE_ENDIAN 0x01020304u
+#define CACHE_ALIGN 64
+#define CACHE_ARRAYS 7
+
+typedef struct {
+	char magic[4];
+	uint32_t endian;
+	uint32_t version;
+	uint32_t checksum;	//Fletcher-64 folded, over everything after the header
+	int32_t vc, vtc, vnc, fc, pc, tc;
+	uint32_t reserved[2];
+	uint64_t offset[CACHE_ARRAYS];	//from the start of the file
+	uint64_t size;	//whole file
+} cache_header_t;
+
+static int Cache = 0;	//LoadWavefront keeps foo.obj.cache files
+
+typedef struct {
+	uint64_t a, b;
+} checksum_t;
+
+static void Checksum(checksum_t *s, const void *data, size_t bytes){
+	const uint32_t *w = data;
+	uint64_t a = s->a, b = s->b;
+	for(size_t i = 0; i < bytes / 4; i++){
+		a += w[i];
+		b += a;
+	}
+	s->a = a;
+	s->b = b;
+}
+
+static uint32_t ChecksumValue(checksum_t *s){
+	uint64_t x = s->a ^ (s->b * 0x9E3779B97F4A7C15ull);
+	return (uint32_t)(x ^ (x >> 32));
+}
+
+static void CacheLayout(cache_header_t *h, const size_t bytes[CACHE_ARRAYS]){
+	uint64_t pos = (sizeof(cache_header_t) + CACHE_ALIGN - 1) & ~(uint64_t)(CACHE_ALIGN - 1);
+	for(int i = 0; i < CACHE_ARRAYS; i++){
+		h->offset[i] = pos;
+		pos = (pos + bytes[i] + CACHE_ALIGN - 1) & ~(uint64_t)(CACHE_ALIGN - 1);
+	}
+	h->size = pos;
+}
+
+static void CacheArrays(wavefront_t *obj, const void *arr[CACHE_ARRAYS], size_t bytes[CACHE_ARRAYS]){
+	arr[0] = obj->vertex;	bytes[0] = sizeof(vector) * obj->vc;
+	arr[1] = obj->texture;	bytes[1] = sizeof(vector) * obj->vtc;
+	arr[2] = obj->normal;	bytes[2] = sizeof(vector) * obj->vnc;
+	arr[3] = obj->index;	bytes[3] = sizeof(polygon_t) * obj->face[obj->fc];
+	arr[4] = obj->face;	bytes[4] = sizeof(int) * (obj->fc + 1);
+	arr[5] = obj->tri;	bytes[5] = sizeof(uint32_t) * 3 * obj->tc;
+	arr[6] = obj->tface;	bytes[6] = sizeof(int) * obj->tc;
+}
+
+/*	A matching checksum only says the file is the one written: every
+	number in it that points into another array is checked once here,
+	before anything follows it.	*/
+static int CacheInBounds(const cache_header_t *h, const char *map){
+	const polygon_t *index = (const polygon_t *)(map + h->offset[3]);
+	const int *face = (const int *)(map + h->offset[4]);
+	const uint32_t *tri = (const uint32_t *)(map + h->offset[5]);
+	const int *tface = (const int *)(map + h->offset[6]);
+	if(face[0] != 0 || face[h->fc] != h->pc)
+		return 0;
+	for(int f = 0; f < h->fc; f++)
+		if(face[f + 1] < face[f])
+			return 0;
+	for(int i = 0; i < h->pc; i++)
+		if(index[i].v < 1 || index[i].v > h->vc || index[i].vt < 0 || index[i].vt > h->vtc ||
+				index[i].vn < 0 || index[i].vn > h->vnc)
+			return 0;
+	for(int i = 0; i < 3 * h->tc; i++)
+		if(tri[i] >= (uint32_t)h->vc)
+			return 0;
+	for(int i = 0; i < h->tc; i++)
+		if(tface[i] < 0 || tface[i] >= h->fc)
+			return 0;
+	return 1;
+}
+
+static int CachePath(const char *filename, char *out, size_t size){
+	return snprintf(out, size, "%s.cache", filename) < (int)size;
+}
+
+/*	1 if path exists and is not older than source */
+static int IsFresh(const char *path, const char *source){
+	struct stat c, s;
+	if(stat(path, &c) != 0 || stat(source, &s) != 0)
+		return 0;
+	if(c.st_mtim.tv_sec != s.st_mtim.tv_sec)
+		return c.st_mtim.tv_sec > s.st_mtim.tv_sec;
+	return c.st_mtim.tv_nsec >= s.st_mtim.tv_nsec;
 }
 
 /*------------------------------------------------- 
 	#        1. Main Publuc      #
 ------------------------------------------------- */
 
-wavefront_t *LoadWavefront(char *filename){
-	char *buffer = FileToBuffer(filename);
+//threads ParseWavefront runs on for len bytes
+static int ParseThreads(size_t len){
+	int n = Threads ? Threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if((size_t)n > len / CHUNK_MIN)
+		n = (int)(len / CHUNK_MIN);
+	return n < 1 ? 1 : n;
+}
+
+static wavefront_t *ParseWavefront(const char *buffer, size_t len){
+#ifdef DEBUG
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+#endif
+	int n = ParseThreads(len);
+	chunk_t ch[n];
+	pthread_t tid[n];
+	size_t start = 0;
+	for(int k = 0; k < n; k++){	//cut right after a newline
+		size_t end = (k == n - 1) ? len : len / n * (k + 1);
+		if(end < start)
+			end = start;
+		const char *nl = (end < len) ? memchr(buffer + end, '\n', len - end) : NULL;
+		if(k != n - 1)
+			end = nl ? (size_t)(nl - buffer) + 1 : len;
+		memset(&ch[k], 0, sizeof(chunk_t));
+		ch[k].buf = buffer + start;
+		ch[k].len = end - start;
+		ch[k].b.chunked = (n > 1);
+		start = end;
+	}
+	int spawned[n];
+	for(int k = 1; k < n; k++){
+		spawned[k] = (pthread_create(&tid[k], NULL, ParseChunk, &ch[k]) == 0);
+		if(!spawned[k])
+			ParseChunk(&ch[k]);
+	}
+	ParseChunk(&ch[0]);
+	for(int k = 1; k < n; k++)
+		if(spawned[k])
+			pthread_join(tid[k], NULL);
+#ifdef DEBUG
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	printf("(dbg) wavefront.c: PARSED %zu BYTES, %d THREADS, %.3f ms\n", len, n,
+			(t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) * 1e-6);
+#endif
+	return BuildWavefront(ch, n);
+}
+
+void WavefrontSetThreads(int threads){
+	Threads = threads < 0 ? 0 : threads;
+}
+
+static wavefront_t *LoadFile(const char *filename, int mapped){
+	char cache[4096];
+	int use_cache = Cache && CachePath(filename, cache, sizeof(cache));
+	if(use_cache && IsFresh(cache, filename)){
+		wavefront_t *obj = LoadWavefrontCache(cache);
+		if(obj != NULL)
+			return obj;
+	}
+	size_t len = 0;
+	const char *buffer = mapped ? MapFile(filename, &len) : FileToBuffer(filename, &len);
 	if(buffer == NULL){
-		fprintf(stderr," (err) wavefront.c: Failed to open %s\n",filename);
+		fprintf(stderr," (err) wavefront.c: Failed to %s %s\n", mapped ? "map" : "open", filename);
 		return NULL;
 	};
-	int count_res[MAX_STATES] = {0,0,0,0,0,0};
-	parser_t FirstRun = {ST_UNDEFINED,{NULL,Count,Count,Count,Count,NULL},count_res};
-	ParseObj(buffer, &FirstRun);
-	wavefront_t *newobj = InitWavefront(count_res[ST_V], count_res[ST_VT], count_res[ST_VN], count_res[ST_F]);
-	int idx[MAX_STATES] = {0,0,0,0,0,0};
-	void *data[] = {newobj, idx};
-	parser_t SecondRun = {ST_UNDEFINED,{NULL,AddVertex,AddTexCoord,AddNormal,AddFace, NULL},data};
-	ParseObj(buffer, &SecondRun);
+	wavefront_t *newobj = ParseWavefront(buffer, len);
+	if(mapped)
+		munmap((void *)buffer, len);
+	else
+		free((void *)buffer);
+	if(use_cache && newobj != NULL)
+		SaveWavefrontCache(newobj, cache);
 	return newobj;
 }
 
+wavefront_t *LoadWavefront(char *filename){
+	return LoadFile(filename, 0);
+}
+
+wavefront_t *LoadMappedWavefront(const char *filename){
+	return LoadFile(filename, 1);
+}
+
 wavefront_t *LoadMemoryWavefront(const char *buffer){
 	if(buffer == NULL){
 		fprintf(stderr," (err) wavefront.c: Failed to open nullptr \n");
 		return NULL;
 	};
-	int count_res[MAX_STATES] = {0,0,0,0,0,0};
-	parser_t FirstRun = {ST_UNDEFINED,{NULL,Count,Count,Count,Count,NULL},count_res};
-	ParseObj(buffer, &FirstRun);
-	wavefront_t *newobj = InitWavefront(count_res[ST_V], count_res[ST_VT], count_res[ST_VN], count_res[ST_F]);
-	int idx[MAX_STATES] = {0,0,0,0,0,0};
-	void *data[] = {newobj, idx};
-	parser_t SecondRun = {ST_UNDEFINED,{NULL,AddVertex,AddTexCoord,AddNormal,AddFace, NULL},data};
-	ParseObj(buffer, &SecondRun);
-	return newobj;
+	return ParseWavefront(buffer, strlen(buffer));
 }
 
 void RemoveWavefront(wavefront_t *obj){ 
-	int i = 0;
-	while(obj->face[i] != NULL){
-		RemovePoly(obj->face[i]);
-		i++;
-	};
-	i = 0;
-	while((obj->vertex)[i] != NULL){
-		free((obj->vertex)[i]);
-		i++;
-	};
-	i = 0;
-	if(obj->texture != NULL){
-		while((obj->texture)[i] != NULL){
-			free((obj->texture)[i]);
-			i++;
-		};
-		i = 0;
-	}
-	if(obj->normal != NULL){
-		while((obj->normal)[i] != NULL){
-			free((obj->normal)[i]);
-			i++;
-		};
-	}
-	free(obj->vertex);
-	free(obj->texture);
-	free(obj->normal);
-	free(obj->face);
-	free(obj);
+	if(obj->map)
+		munmap(obj->map, obj->maplen);
+	ReleaseArena(obj->alloc, obj->arena);	//obj itself lives there too
+}
+
+void WavefrontSetAllocator(const wavefront_allocator_t *alloc){
+	wavefront_allocator_t def = {DefaultAlloc, DefaultFree, NULL};
+	Allocator = alloc ? *alloc : def;
 }
 
 void WavefrontPrintLog(wavefront_t *obj){
-	int v = 0; int vt = 0; int vn = 0;
-	while ((obj->vertex)[v] != NULL) {
-		v++;
-	}
-	int i = 0; 
-	while(FACE(obj,i) != NULL){
+	for(int i = 0; i < obj->fc; i++){
 		printf("FACE #%i\n",i);
-		for(polygon_t *cur = FACE(obj,i); cur != NULL; cur = cur->next){
+		polygon_t *cur = FACE(obj,i);
+		for(polygon_t *end = cur + FACE_SIZE(obj,i); cur != end; cur++){
 			printf(" vertex\t(%i):\t",cur->v);
 			printf("%f,\t%f,\t%f\n",
 					VERTEX(obj,cur->v - 1,X),
 					VERTEX(obj,cur->v - 1,Y),
 					VERTEX(obj,cur->v - 1,Z));
-			if(obj->texture != NULL){
+			if(obj->texture != NULL && cur->vt != 0){
 				printf(" textur\t(%i):\t",cur->vt);
 				printf("%f,\t%f,\t%f\n",
 						TEXTURE(obj,cur->vt - 1,X),
 						TEXTURE(obj,cur->vt - 1,Y),
 						TEXTURE(obj,cur->vt - 1,Z));
 			};
-			if(obj->normal != NULL){
+			if(obj->normal != NULL && cur->vn != 0){
 				printf(" normal\t(%i):\t",cur->vn);
 				printf("%f,\t%f,\t%f\n",
 						NORMAL(obj,cur->vn - 1,X),
@@ -358,7 +924,6 @@ void WavefrontPrintLog(wavefront_t *obj){
 			};
 		};
 		printf("\n\n");
-		i++;
 	};
 }
 
@@ -366,113 +931,1186 @@ void WavefrontPrintLog(wavefront_t *obj){
 	#       2. Geometry      #
 ------------------------------------------------- */
 
-static inline void ComputeNormal(vector v1, vector v2, vector v3, vector n){
-	vector u, v;
-	vec_sub(v2,v1,u); //u = v2 - v1
-	vec_sub(v3,v1,v); //v = v3 - v1
-	vec_cross(u,v,n); //n = u x v
+/*	Vertex normals are the normalized sum of the normals of the
+	triangles around the vertex (so bigger ones weigh more). The
+	vertex -> triangle lists are built on the first call and kept
+	in the arena.	*/
+
+#define NORMALS_MIN 4096	//triangles per thread, less is done at once
+#define DIRTY_FULL 8	//more than vc / DIRTY_FULL dirty vertices - recompute all
+
+struct wavefront_adjacency {
+	int *start;	//vc + 1 offsets into tri
+	int *tri;	//triangles around each vertex
+	vector *tnormal;	//tc triangle normals, not normalized
+	uint64_t *vmark, *tmark;	//bit sets over vertices and triangles
+	int *dirty, ndirty;	//marked vertices, in the order they were marked
+	int *touched;	//triangle list of an incremental update
+	int all;	//everything is stale (new mesh, TurnWavefront)
+};
+
+#define BIT_TEST(set,n) ((set)[(n) >> 6] & (1ull << ((n) & 63)))
+#define BIT_SET(set,n) ((set)[(n) >> 6] |= (1ull << ((n) & 63)))
+#define BIT_CLEAR(set,n) ((set)[(n) >> 6] &= ~(1ull << ((n) & 63)))
+
+static wavefront_adjacency_t *BuildAdjacency(wavefront_t *obj){
+	int tc = obj->tc, n = 3 * tc;
+	size_t vwords = (obj->vc + 63) / 64, twords = (tc + 63) / 64;
+	wavefront_adjacency_t *a = ArenaAlloc(obj, sizeof(wavefront_adjacency_t));
+	if(a == NULL)
+		return NULL;
+	memset(a, 0, sizeof(wavefront_adjacency_t));
+	a->start = ArenaAlloc(obj, sizeof(int) * (obj->vc + 1));
+	a->tri = ArenaAlloc(obj, sizeof(int) * (n ? n : 1));
+	a->tnormal = ArenaAlloc(obj, sizeof(vector) * (tc ? tc : 1));
+	a->vmark = ArenaAlloc(obj, sizeof(uint64_t) * vwords);
+	a->tmark = ArenaAlloc(obj, sizeof(uint64_t) * (twords ? twords : 1));
+	a->dirty = ArenaAlloc(obj, sizeof(int) * obj->vc);
+	a->touched = ArenaAlloc(obj, sizeof(int) * (tc ? tc : 1));
+	if(!a->start || !a->tri || !a->tnormal || !a->vmark || !a->tmark || !a->dirty || !a->touched)
+		return NULL;
+	memset(a->vmark, 0, sizeof(uint64_t) * vwords);
+	memset(a->tmark, 0, sizeof(uint64_t) * twords);
+	memset(a->start, 0, sizeof(int) * (obj->vc + 1));
+	for(int i = 0; i < n; i++)	//counting sort of the corners by vertex
+		a->start[obj->tri[i]]++;
+	for(int v = 1; v < obj->vc; v++)	//start[v] - end of the run of v
+		a->start[v] += a->start[v - 1];
+	a->start[obj->vc] = n;
+	for(int i = n - 1; i >= 0; i--)	//filled backwards, start[v] ends up at its beginning
+		a->tri[--a->start[obj->tri[i]]] = i / 3;
+	a->all = 1;
+	return a;
 }
 
-void WavefrontCalculateNormals(wavefront_t *obj){
-	int v = 0;
-	if(obj->normal != NULL) {
-		free(obj->normal);
-	};
-	while ((obj->vertex)[v] != NULL) {
-		v++;
+static inline vec4_t TriangleNormal(const wavefront_t *obj, int t){
+	const uint32_t *v = obj->tri + 3 * t;
+	vec4_t p0 = vec4_load3(obj->vertex[v[0]]);
+	return vec4_cross3(vec4_sub(vec4_load3(obj->vertex[v[1]]), p0),
+		vec4_sub(vec4_load3(obj->vertex[v[2]]), p0));	//(v1 - v0) x (v2 - v0)
+}
+
+//gathers the triangles around v: no vertex is written by two threads
+static inline void VertexNormal(const wavefront_t *obj, const wavefront_adjacency_t *a, int v){
+	vec4_t n = vec4_splat(0.0f);
+	for(int k = a->start[v]; k < a->start[v + 1]; k++)
+		n = vec4_add(n, vec4_load3(a->tnormal[a->tri[k]]));
+	vec4_store3(obj->normal[v], vec4_normalize3(n));
+}
+
+typedef struct {
+	wavefront_t *obj;
+	int t0, t1, v0, v1;	//triangles and vertices this thread owns
+	int pass;	//0 - triangles, 1 - vertices
+} normals_job_t;
+
+static void *NormalsJob(void *arg){
+	normals_job_t *j = arg;
+	wavefront_adjacency_t *a = j->obj->adj;
+	if(j->pass == 0)
+		for(int t = j->t0; t < j->t1; t++)
+			vec4_store3(a->tnormal[t], TriangleNormal(j->obj, t));
+	else
+		for(int v = j->v0; v < j->v1; v++)
+			VertexNormal(j->obj, a, v);
+	return NULL;
+}
+
+/*	Two passes split by owner, triangles then vertices, so every
+	thread accumulates into its own slice and nothing needs atomics. */
+static void FullNormals(wavefront_t *obj){
+	int n = Threads ? Threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(n > obj->tc / NORMALS_MIN)
+		n = obj->tc / NORMALS_MIN;
+	if(n < 1)
+		n = 1;
+	normals_job_t job[n];
+	pthread_t tid[n];
+	int spawned[n];
+	for(int k = 0; k < n; k++){
+		job[k].obj = obj;
+		job[k].t0 = (int)((int64_t)obj->tc * k / n);
+		job[k].t1 = (int)((int64_t)obj->tc * (k + 1) / n);
+		job[k].v0 = (int)((int64_t)obj->vc * k / n);
+		job[k].v1 = (int)((int64_t)obj->vc * (k + 1) / n);
 	}
-	obj->normal = malloc((sizeof(float *)) * (v + 1));
-	for (int vn = 0; vn < v; vn++) {
-		obj->normal[vn] = (float *)malloc(3 * sizeof(float));
-		obj->normal[vn][X] = 0;
-		obj->normal[vn][Y] = 0;
-		obj->normal[vn][Z] = 0;
+	for(int pass = 0; pass < 2; pass++){
+		for(int k = 0; k < n; k++)
+			job[k].pass = pass;
+		for(int k = 1; k < n; k++){
+			spawned[k] = (pthread_create(&tid[k], NULL, NormalsJob, &job[k]) == 0);
+			if(!spawned[k])
+				NormalsJob(&job[k]);
+		}
+		NormalsJob(&job[0]);
+		for(int k = 1; k < n; k++)
+			if(spawned[k])
+				pthread_join(tid[k], NULL);
 	}
-	obj->normal[v] = NULL;
-	int i = 0;
-	vector p0,p1,p2, n;
-	while(FACE(obj, i) != NULL) {
-		polygon_t *fst = FACE(obj, i);
-		fst->vn = fst->v;
-		COPY_POINT(obj,fst->v,p0);
-		polygon_t *prv = FACE(obj, i)->next;
-		polygon_t *cur = FACE(obj, i)->next->next;
-		do{
-			prv->vn = prv->v;
-			cur->vn = cur->v;
-			COPY_POINT(obj,prv->v,p1);
-			COPY_POINT(obj,cur->v,p2);
-			ComputeNormal(p0,p1,p2, n); //n = comp_normal()
-			NORMAL(obj,fst->vn - 1,X) -= n[X];
-			NORMAL(obj,fst->vn - 1,Y) -= n[Y];
-			NORMAL(obj,fst->vn - 1,Z) -= n[Z];
-			NORMAL(obj,prv->vn - 1,X) -= n[X];
-			NORMAL(obj,prv->vn - 1,Y) -= n[Y];
-			NORMAL(obj,prv->vn - 1,Z) -= n[Z];
-			NORMAL(obj,cur->vn - 1,X) -= n[X];
-			NORMAL(obj,cur->vn - 1,Y) -= n[Y];
-			NORMAL(obj,cur->vn - 1,Z) -= n[Z];
-			prv = cur;
-			cur = cur->next;
-		} while(cur != NULL);
-		i++;
-	}
-	for(int vn = 0; vn < v; vn++) {
-		vec_normalize(obj->normal[vn]);
+}
+
+/*	Only the triangles around the dirty vertices, then every vertex
+	of those triangles: the dirty list grows to hold them.	*/
+static void DirtyNormals(wavefront_t *obj){
+	wavefront_adjacency_t *a = obj->adj;
+	int nt = 0, nd = a->ndirty;
+	for(int i = 0; i < nd; i++){
+		int v = a->dirty[i];
+		for(int k = a->start[v]; k < a->start[v + 1]; k++){
+			int t = a->tri[k];
+			if(BIT_TEST(a->tmark, t))
+				continue;
+			BIT_SET(a->tmark, t);
+			a->touched[nt++] = t;
+			vec4_store3(a->tnormal[t], TriangleNormal(obj, t));
+		}
+	}
+	for(int i = 0; i < nt; i++){
+		int t = a->touched[i];
+		BIT_CLEAR(a->tmark, t);
+		for(int k = 0; k < 3; k++){
+			int v = obj->tri[3 * t + k];
+			if(!BIT_TEST(a->vmark, v)){
+				BIT_SET(a->vmark, v);
+				a->dirty[a->ndirty++] = v;
+			}
+		}
 	}
+	for(int i = 0; i < a->ndirty; i++)
+		VertexNormal(obj, a, a->dirty[i]);
+}
+
+static void ClearDirty(wavefront_adjacency_t *a){
+	for(int i = 0; i < a->ndirty; i++)
+		BIT_CLEAR(a->vmark, a->dirty[i]);
+	a->ndirty = 0;
+	a->all = 0;
+}
+
+static inline void MarkDirty(wavefront_t *obj, int id){
+	wavefront_adjacency_t *a = obj->adj;
+	if(a == NULL || a->all || BIT_TEST(a->vmark, id))
+		return;
+	if(a->ndirty >= obj->vc / DIRTY_FULL){
+		a->all = 1;	//not worth tracking any longer
+		return;
+	}
+	BIT_SET(a->vmark, id);
+	a->dirty[a->ndirty++] = id;
+}
+
+/*	Switches the mesh to one normal per vertex (vn = v). The old
+	table is reused if it is big enough, otherwise it stays in the
+	arena till RemoveWavefront.	*/
+static int PrepareNormals(wavefront_t *obj){
+	if(obj->adj == NULL){
+		obj->adj = BuildAdjacency(obj);
+		if(obj->adj == NULL){
+			fprintf(stderr," (err) wavefront.c: Can't allocate vertex adjacency\n");
+			return 0;
+		}
+	}
+	if(obj->vnc < obj->vc){
+		vector *normal = ArenaAlloc(obj, sizeof(vector) * obj->vc);
+		if(normal == NULL)
+			return 0;
+		obj->normal = normal;
+		obj->adj->all = 1;
+	}
+	int pc = obj->face[obj->fc], remap = obj->vnc != obj->vc;
+	for(int p = 0; p < pc && !remap; p++)
+		remap = obj->index[p].vn != obj->index[p].v;	//as many normals, but not per vertex
+	if(remap){
+		for(int p = 0; p < pc; p++)
+			obj->index[p].vn = obj->index[p].v;
+		obj->vnc = obj->vc;
+		obj->adj->all = 1;
+	}
+	return 1;
+}
+
+void WavefrontCalculateNormals(wavefront_t *obj){
+	if(!PrepareNormals(obj))
+		return;
+	FullNormals(obj);
+	ClearDirty(obj->adj);
+}
+
+void WavefrontUpdateNormals(wavefront_t *obj){
+	if(!PrepareNormals(obj))
+		return;
+	if(obj->adj->all)
+		FullNormals(obj);
+	else if(obj->adj->ndirty)
+		DirtyNormals(obj);
+	ClearDirty(obj->adj);
+}
+
+/*	The box is exact after load, TurnWavefront and CalculateBounds;
+	the sphere is centered on the box then and only moved with the
+	mesh afterwards. Move/SetVertex only grow both.	*/
+
+static void BoxBounds(wavefront_t *obj){
+	vec4_t lo = vec4_load3(obj->vertex[0]), hi = lo;
+	for(int n = 1; n < obj->vc; n++){
+		vec4_t p = vec4_load3(obj->vertex[n]);
+		lo = vec4_min(lo, p);
+		hi = vec4_max(hi, p);
+	}
+	vec4_store3(obj->bmin, lo);
+	vec4_store3(obj->bmax, hi);
+}
+
+static void GrowBounds(wavefront_t *obj, int id){
+	vec4_t p = vec4_load3(obj->vertex[id]);
+	vec4_store3(obj->bmin, vec4_min(vec4_load3(obj->bmin), p));
+	vec4_store3(obj->bmax, vec4_max(vec4_load3(obj->bmax), p));
+	float d = vec4_length3(vec4_sub(p, vec4_load3(obj->center)));
+	if(d > obj->radius)
+		obj->radius = d;
+}
+
+void WavefrontCalculateBounds(wavefront_t *obj){
+	BoxBounds(obj);
+	vec4_t c = vec4_scale(vec4_add(vec4_load3(obj->bmin), vec4_load3(obj->bmax)), 0.5f);
+	float r2 = 0.0f;
+	for(int n = 0; n < obj->vc; n++){
+		vec4_t d = vec4_sub(vec4_load3(obj->vertex[n]), c);
+		r2 = fmaxf(r2, vec4_dot3(d, d));
+	}
+	vec4_store3(obj->center, c);
+	obj->radius = sqrtf(r2);
 }
 
 void TurnWavefront(wavefront_t *obj, float alpha, float beta, float gamma){
-	float a,b,c,d,e,f,g,h,i;
-	int n = 0;
-	a = cosf(beta)*cosf(gamma);
-	b = -sinf(gamma)*cosf(beta);
-	c = sinf(beta);
-	d = sinf(alpha)*sinf(beta)*cosf(gamma) + sinf(gamma)*cos(alpha);
-	e = -sinf(alpha)*sinf(beta)*sinf(gamma) + cosf(alpha)*cosf(gamma);
-	f = - sinf(alpha)*cosf(beta);
-	g = sinf(alpha)*sinf(gamma) - sinf(beta)*cosf(alpha)*cosf(gamma);
-	h = sinf(alpha)*cosf(gamma) + sinf(beta)*sinf(gamma)*cosf(alpha);
-	i = cosf(alpha)*cosf(beta);
-	while((obj->vertex)[n] != NULL){
-		float x = VERTEX(obj,n,X);
-		float y = VERTEX(obj,n,Y);
-		float z = VERTEX(obj,n,Z);
-		VERTEX(obj,n,X) = x*a + y*b + z*c;
-		VERTEX(obj,n,Y) = x*d + y*e + z*f;
-		VERTEX(obj,n,Z) = x*g + y*h + z*i;
-		n++;
-	};
+	mat4_t m = mat4_rotate(alpha, beta, gamma);
+	vec3_transform_n(&m, obj->vertex, obj->vertex, obj->vc);
+	vec3_transform_n(&m, &obj->center, &obj->center, 1);
+	BoxBounds(obj);	//a turned box is looser than the new one
+	if(obj->adj)
+		obj->adj->all = 1;
 }
 
 void MoveWavefront(wavefront_t *obj, float dx, float dy, float dz){
-	int n = 0;
-	while((obj->vertex)[n] != NULL){
-		VERTEX(obj,n,X) += dx;
-		VERTEX(obj,n,Y) += dy;
-		VERTEX(obj,n,Z) += dz;
-		n++;
-	};
+	mat4_t m = mat4_translate(dx, dy, dz);
+	vec3_transform_n(&m, obj->vertex, obj->vertex, obj->vc);
+	vec3_transform_n(&m, &obj->bmin, &obj->bmin, 1);
+	vec3_transform_n(&m, &obj->bmax, &obj->bmax, 1);
+	vec3_transform_n(&m, &obj->center, &obj->center, 1);
 }
 
 void ScaleWavefront(wavefront_t *obj, float multipler){
-	int n = 0;
-	while((obj->vertex)[n] != NULL){
-		VERTEX(obj,n,X) *= multipler;
-		VERTEX(obj,n,Y) *= multipler;
-		VERTEX(obj,n,Z) *= multipler;
-		n++;
-	};
+	mat4_t m = mat4_scale(multipler, multipler, multipler);
+	vec3_transform_n(&m, obj->vertex, obj->vertex, obj->vc);
+	vec4_t lo = vec4_scale(vec4_load3(obj->bmin), multipler);
+	vec4_t hi = vec4_scale(vec4_load3(obj->bmax), multipler);
+	vec4_store3(obj->bmin, vec4_min(lo, hi));	//a negative one swaps them
+	vec4_store3(obj->bmax, vec4_max(lo, hi));
+	vec4_store3(obj->center, vec4_scale(vec4_load3(obj->center), multipler));
+	obj->radius *= fabsf(multipler);
 }
 
 void MoveVertex(wavefront_t *obj, int id, float dx, float dy, float dz){
 	VERTEX(obj,id,X) += dx;
 	VERTEX(obj,id,Y) += dy;
 	VERTEX(obj,id,Z) += dz;
+	GrowBounds(obj, id);
+	MarkDirty(obj, id);
 }
 
 void SetVertex(wavefront_t *obj, int id, float x, float y, float z){
 	VERTEX(obj,id,X) = x;
 	VERTEX(obj,id,Y) = y;
 	VERTEX(obj,id,Z) = z;
+	GrowBounds(obj, id);
+	MarkDirty(obj, id);
+}
+
+/*------------------------------------------------- 
+	#       3. Binary Cache      #
+------------------------------------------------- */
+
+int SaveWavefrontCache(wavefront_t *obj, const char *filename){
+	char tmp[4096];
+	if(snprintf(tmp, sizeof(tmp), "%s.tmp", filename) >= (int)sizeof(tmp))
+		return -1;
+	FILE *file = fopen(tmp, "wb");
+	if(!file)
+		return -1;
+	const void *arr[CACHE_ARRAYS];
+	size_t bytes[CACHE_ARRAYS];
+	static const char zero[CACHE_ALIGN];
+	cache_header_t h;
+	checksum_t sum = {1, 0};
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, CACHE_MAGIC, 4);
+	h.endian = CACHE_ENDIAN;
+	h.version = CACHE_VERSION;
+	h.vc = obj->vc;
+	h.vtc = obj->vtc;
+	h.vnc = obj->vnc;
+	h.fc = obj->fc;
+	h.pc = obj->face[obj->fc];
+	h.tc = obj->tc;
+	CacheArrays(obj, arr, bytes);
+	CacheLayout(&h, bytes);
+	int ok = fwrite(&h, sizeof(h), 1, file) == 1;
+	uint64_t pos = sizeof(h);
+	for(int i = 0; i < CACHE_ARRAYS && ok; i++){
+		size_t pad = h.offset[i] - pos;	//< CACHE_ALIGN
+		Checksum(&sum, zero, pad);
+		Checksum(&sum, arr[i], bytes[i]);
+		ok = fwrite(zero, 1, pad, file) == pad && fwrite(arr[i], 1, bytes[i], file) == bytes[i];
+		pos = h.offset[i] + bytes[i];
+	}
+	Checksum(&sum, zero, h.size - pos);
+	ok = ok && fwrite(zero, 1, h.size - pos, file) == h.size - pos;
+	h.checksum = ChecksumValue(&sum);
+	ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, file) == 1;
+	ok = (fclose(file) == 0) && ok;
+	if(!ok || rename(tmp, filename) != 0){
+		fprintf(stderr," (err) wavefront.c: Failed to write cache %s\n", filename);
+		remove(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+wavefront_t *LoadWavefrontCache(const char *filename){
+	int fd = open(filename, O_RDONLY);
+	if(fd < 0)
+		return NULL;
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(cache_header_t)){
+		close(fd);
+		return NULL;
+	}
+	size_t len = (size_t)st.st_size;
+	//private writable mapping: transforms touch pages copy-on-write, the file stays intact
+	char *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+		return NULL;
+	cache_header_t *h = (cache_header_t *)map;
+	int ok = memcmp(h->magic, CACHE_MAGIC, 4) == 0 && h->endian == CACHE_ENDIAN &&
+		h->version == CACHE_VERSION && h->size == len && h->vc > 0 &&
+		h->vtc >= 0 && h->vnc >= 0 && h->fc >= 0 && h->pc >= 0 && h->tc >= 0;
+	if(ok){
+		size_t bytes[CACHE_ARRAYS] = {sizeof(vector) * h->vc, sizeof(vector) * h->vtc,
+			sizeof(vector) * h->vnc, sizeof(polygon_t) * h->pc, sizeof(int) * (h->fc + 1),
+			sizeof(uint32_t) * 3 * h->tc, sizeof(int) * h->tc};
+		cache_header_t layout = *h;
+		CacheLayout(&layout, bytes);
+		ok = memcmp(layout.offset, h->offset, sizeof(h->offset)) == 0 && layout.size == len;
+	}
+	if(ok){
+		checksum_t sum = {1, 0};
+		madvise(map, len, MADV_WILLNEED);
+		Checksum(&sum, map + sizeof(cache_header_t), len - sizeof(cache_header_t));
+		ok = ChecksumValue(&sum) == h->checksum && CacheInBounds(h, map);
+	}
+	if(!ok){
+		fprintf(stderr," (err) wavefront.c: Bad cache %s\n", filename);
+		munmap(map, len);
+		return NULL;
+	}
+	wavefront_t *result = NewWavefront(0, 0);
+	if(result == NULL){
+		munmap(map, len);
+		return NULL;
+	}
+	result->vc = h->vc;
+	result->vtc = h->vtc;
+	result->vnc = h->vnc;
+	result->fc = h->fc;
+	result->vertex = (vector *)(map + h->offset[0]);
+	result->texture = h->vtc ? (vector *)(map + h->offset[1]) : NULL;
+	result->normal = h->vnc ? (vector *)(map + h->offset[2]) : NULL;
+	result->index = (polygon_t *)(map + h->offset[3]);
+	result->face = (int *)(map + h->offset[4]);
+	result->tri = (uint32_t *)(map + h->offset[5]);
+	result->tface = (int *)(map + h->offset[6]);
+	result->tc = h->tc;
+	result->map = map;
+	result->maplen = len;
+	WavefrontCalculateBounds(result);
+	return result;
+}
+
+void WavefrontSetCache(int enable){
+	Cache = enable;
+}
+
+/*------------------------------------------------- 
+	#       4. Vertex Cache Optimization      #
+------------------------------------------------- */
+/*	Every distinct (v, vt, vn) corner becomes one vertex, so one
+	index addresses the position, texture and normal alike. Faces
+	are cut into triangles as at load, which are reordered for a post-
+	transform vertex cache with Forsyth's linear-speed scoring, and
+	vertices get renumbered in the order the triangles first use
+	them. The old arrays stay in the arena (or the cache mapping)
+	till RemoveWavefront.	*/
+
+#define VCACHE_SIZE 32	//LRU cache the triangle order is tuned for
+#define VCACHE_FIFO 16	//FIFO cache the ACMR is reported for
+#define VALENCE_TABLE 64
+
+static float CacheScore[VCACHE_SIZE], ValenceScore[VALENCE_TABLE];
+static pthread_once_t ScoreOnce = PTHREAD_ONCE_INIT;
+
+static void InitScores(void){
+	for(int i = 0; i < VCACHE_SIZE; i++)	//the last triangle's 3 get a fixed score
+		CacheScore[i] = i < 3 ? 0.75f : powf(1.0f - (i - 3) * (1.0f / (VCACHE_SIZE - 3)), 1.5f);
+	for(int i = 1; i < VALENCE_TABLE; i++)	//fewer triangles left - sooner done
+		ValenceScore[i] = 2.0f * powf((float)i, -0.5f);
+}
+
+static inline float VertexScore(int pos, int remaining){
+	if(remaining == 0)
+		return -1.0f;
+	float s = pos >= 0 ? CacheScore[pos] : 0.0f;
+	return s + (remaining < VALENCE_TABLE ? ValenceScore[remaining] : 2.0f * powf((float)remaining, -0.5f));
+}
+
+static inline uint32_t HashCorner(const polygon_t *p){
+	uint32_t h = (uint32_t)p->v * 0x9E3779B1u ^ (uint32_t)p->vt * 0x85EBCA77u ^ (uint32_t)p->vn * 0xC2B2AE3Du;
+	return h ^ (h >> 15);
+}
+
+/*	Open addressing over the corners; corner[p] gets the number of
+	its vertex, uniq[] the first corner of each. Returns the count.	*/
+static int WeldCorners(const wavefront_t *obj, int *corner, int *uniq){
+	int pc = obj->face[obj->fc], nu = 0;
+	size_t size = 16;
+	while(size < (size_t)pc * 2)
+		size *= 2;
+	int *slot = malloc(sizeof(int) * size);
+	if(slot == NULL)
+		return -1;
+	memset(slot, 0xFF, sizeof(int) * size);
+	for(int p = 0; p < pc; p++){
+		const polygon_t *c = &obj->index[p];
+		size_t h = HashCorner(c) & (size - 1);
+		for(;; h = (h + 1) & (size - 1)){
+			if(slot[h] < 0){
+				slot[h] = nu;
+				uniq[nu++] = p;
+				break;
+			}
+			const polygon_t *u = &obj->index[uniq[slot[h]]];
+			if(u->v == c->v && u->vt == c->vt && u->vn == c->vn)
+				break;
+		}
+		corner[p] = slot[h];
+	}
+	free(slot);
+	return nu;
+}
+
+//vertex transforms per triangle with a FIFO cache, stamp[] - nv ints
+static float Acmr(const int *tri, int ntri, int nv, int *stamp){
+	int misses = 0;
+	for(int i = 0; i < nv; i++)
+		stamp[i] = -VCACHE_FIFO;
+	for(int i = 0; i < 3 * ntri; i++)
+		if(misses - stamp[tri[i]] >= VCACHE_FIFO)	//in the cache while fewer misses came after it
+			stamp[tri[i]] = misses++;
+	return ntri ? (float)misses / ntri : 0.0f;
+}
+
+/*	Emits the best scored triangle around the cache, or the next one
+	left in input order when nothing in the cache has any.	*/
+static int ForsythOrder(const int *tri, int ntri, int nv, int *out){
+	int *start = malloc(sizeof(int) * (nv + 1));
+	int *left = calloc(nv, sizeof(int));	//triangles still to emit, listed first
+	int *list = malloc(sizeof(int) * 3 * (ntri ? ntri : 1));
+	int *pos = malloc(sizeof(int) * nv);
+	float *vscore = malloc(sizeof(float) * nv);
+	float *tscore = malloc(sizeof(float) * (ntri ? ntri : 1));
+	unsigned char *done = calloc(ntri ? ntri : 1, 1);
+	int ok = start && left && list && pos && vscore && tscore && done;
+	if(ok){
+		pthread_once(&ScoreOnce, InitScores);
+		for(int i = 0; i < 3 * ntri; i++)
+			left[tri[i]]++;
+		start[0] = 0;
+		for(int v = 0; v < nv; v++)
+			start[v + 1] = start[v] + left[v];
+		memset(left, 0, sizeof(int) * nv);
+		for(int t = 0; t < ntri; t++)
+			for(int k = 0; k < 3; k++){
+				int v = tri[3 * t + k];
+				list[start[v] + left[v]++] = t;
+			}
+		for(int v = 0; v < nv; v++){
+			pos[v] = -1;
+			vscore[v] = VertexScore(-1, left[v]);
+		}
+		for(int t = 0; t < ntri; t++)
+			tscore[t] = vscore[tri[3 * t]] + vscore[tri[3 * t + 1]] + vscore[tri[3 * t + 2]];
+		int cache[VCACHE_SIZE + 3], ncache = 0, next = 0, best = -1;
+		for(int n = 0; n < ntri; n++){
+			if(best < 0){
+				while(done[next])
+					next++;
+				best = next;
+			}
+			const int *bt = tri + 3 * best;
+			memcpy(out + 3 * n, bt, sizeof(int) * 3);
+			done[best] = 1;
+			for(int k = 0; k < 3; k++){	//off the lists of its vertices
+				int v = bt[k], *l = list + start[v];
+				for(int i = 0; i < left[v]; i++)
+					if(l[i] == best){
+						l[i] = l[--left[v]];
+						l[left[v]] = best;
+						break;
+					}
+			}
+			int fresh[VCACHE_SIZE + 3], nfresh = 0;	//its 3 first, then the rest in LRU order
+			for(int k = 0; k < 3; k++)
+				fresh[nfresh++] = bt[k];
+			for(int i = 0; i < ncache; i++)
+				if(cache[i] != bt[0] && cache[i] != bt[1] && cache[i] != bt[2])
+					fresh[nfresh++] = cache[i];
+			best = -1;
+			float top = -1.0f;
+			for(int i = 0; i < nfresh; i++){
+				int v = fresh[i];
+				pos[v] = i < VCACHE_SIZE ? i : -1;
+				vscore[v] = VertexScore(pos[v], left[v]);
+			}
+			for(int i = 0; i < nfresh; i++){
+				int v = fresh[i];
+				for(int k = 0; k < left[v]; k++){
+					int t = list[start[v] + k];
+					const int *tv = tri + 3 * t;
+					tscore[t] = vscore[tv[0]] + vscore[tv[1]] + vscore[tv[2]];
+					if(tscore[t] > top){
+						top = tscore[t];
+						best = t;
+					}
+				}
+			}
+			ncache = nfresh < VCACHE_SIZE ? nfresh : VCACHE_SIZE;
+			memcpy(cache, fresh, sizeof(int) * ncache);
+		}
+	}
+	free(start);
+	free(left);
+	free(list);
+	free(pos);
+	free(vscore);
+	free(tscore);
+	free(done);
+	return ok ? 0 : -1;
+}
+
+typedef struct {
+	int *corner;	//pc: vertex of every point
+	int *uniq;	//first point of every vertex
+	int *tri, *order;	//3 * ntri vertices: fanned, reordered
+	int *remap;	//vertex -> its number after
+} optimize_t;
+
+static int OptimizeMesh(wavefront_t *obj, optimize_t *o, int ntri, wavefront_optimize_t *rep){
+	int pc = obj->face[obj->fc], nu = WeldCorners(obj, o->corner, o->uniq);
+	if(nu < 0 || (o->remap = malloc(sizeof(int) * (nu ? nu : 1))) == NULL)
+		return -1;
+	ring_t ring = {NULL, NULL, NULL, 0};
+	int t = 0, k = 0;
+	for(int f = 0; f < obj->fc; f++, t += k){	//the cuts of the load, now over corners
+		if((k = TriangulateFace(obj, f, o->tri + 3 * t, &ring)) < 0)
+			break;
+		for(int i = 3 * t; i < 3 * (t + k); i++)
+			o->tri[i] = o->corner[o->tri[i]];
+	}
+	free(ring.p);
+	if(k < 0)
+		return -1;
+	ntri = t;
+	rep->corners = pc;
+	rep->vertices = nu;
+	rep->triangles = ntri;
+	rep->acmr_before = Acmr(o->tri, ntri, nu, o->remap);
+	if(ForsythOrder(o->tri, ntri, nu, o->order) != 0)
+		return -1;
+	int nv = 0;	//vertex fetch order: first use, then the ones no triangle uses
+	memset(o->remap, 0xFF, sizeof(int) * nu);
+	for(int i = 0; i < 3 * ntri; i++)
+		if(o->remap[o->order[i]] < 0)
+			o->remap[o->order[i]] = nv++;
+	for(int u = 0; u < nu; u++)
+		if(o->remap[u] < 0)
+			o->remap[u] = nv++;
+	vector *vertex = ArenaAlloc(obj, sizeof(vector) * (nu ? nu : 1));
+	vector *texture = obj->vtc ? ArenaAlloc(obj, sizeof(vector) * (nu ? nu : 1)) : NULL;
+	vector *normal = obj->vnc ? ArenaAlloc(obj, sizeof(vector) * (nu ? nu : 1)) : NULL;
+	polygon_t *index = ArenaAlloc(obj, sizeof(polygon_t) * 3 * (ntri ? ntri : 1));
+	int *face = ArenaAlloc(obj, sizeof(int) * (ntri + 1));
+	uint32_t *tri = ArenaAlloc(obj, sizeof(uint32_t) * 3 * (ntri ? ntri : 1));
+	int *tface = ArenaAlloc(obj, sizeof(int) * (ntri ? ntri : 1));
+	if(!vertex || (obj->vtc && !texture) || (obj->vnc && !normal) || !index || !face || !tri || !tface)
+		return -1;
+	static const vector zero = {0.0f, 0.0f, 0.0f};
+	for(int u = 0; u < nu; u++){
+		const polygon_t *c = &obj->index[o->uniq[u]];
+		int v = o->remap[u];
+		memcpy(vertex[v], obj->vertex[c->v - 1], sizeof(vector));
+		if(texture)
+			memcpy(texture[v], c->vt ? obj->texture[c->vt - 1] : zero, sizeof(vector));
+		if(normal)
+			memcpy(normal[v], c->vn ? obj->normal[c->vn - 1] : zero, sizeof(vector));
+	}
+	for(int i = 0; i < 3 * ntri; i++){
+		int v = o->remap[o->order[i]] + 1;
+		index[i].v = v;
+		index[i].vt = texture ? v : 0;
+		index[i].vn = normal ? v : 0;
+		tri[i] = o->order[i] = v - 1;
+	}
+	for(int f = 0; f <= ntri; f++)
+		face[f] = 3 * f;
+	for(int f = 0; f < ntri; f++)
+		tface[f] = f;
+	rep->acmr_after = Acmr(o->order, ntri, nu, o->remap);
+	obj->vertex = vertex;
+	obj->texture = texture;
+	obj->normal = normal;
+	obj->index = index;
+	obj->face = face;
+	obj->vc = nu;
+	obj->vtc = texture ? nu : 0;
+	obj->vnc = normal ? nu : 0;
+	obj->fc = ntri;
+	obj->tri = tri;
+	obj->tface = tface;
+	obj->tc = ntri;
+	obj->adj = NULL;	//built again on the next *Normals()
+	return 0;
+}
+
+int WavefrontOptimize(wavefront_t *obj, wavefront_optimize_t *report){
+	int pc = obj->face[obj->fc], ntri = 0;
+	for(int f = 0; f < obj->fc; f++)
+		ntri += FACE_SIZE(obj, f) > 2 ? FACE_SIZE(obj, f) - 2 : 0;
+	optimize_t o = {malloc(sizeof(int) * (pc ? pc : 1)), malloc(sizeof(int) * (pc ? pc : 1)),
+		malloc(sizeof(int) * 3 * (ntri ? ntri : 1)), malloc(sizeof(int) * 3 * (ntri ? ntri : 1)), NULL};
+	wavefront_optimize_t rep;
+	int result = -1;
+	if(o.corner && o.uniq && o.tri && o.order)
+		result = OptimizeMesh(obj, &o, ntri, &rep);
+	free(o.corner);
+	free(o.uniq);
+	free(o.tri);
+	free(o.order);
+	free(o.remap);
+	if(result != 0){
+		fprintf(stderr," (err) wavefront.c: Can't allocate the optimized mesh\n");
+		return -1;
+	}
+#ifdef DEBUG
+	printf("(dbg) wavefront.c: WELDED %d CORNERS INTO %d VERTICES, %d TRIANGLES, ACMR %.3f -> %.3f\n",
+		rep.corners, rep.vertices, rep.triangles, rep.acmr_before, rep.acmr_after);
+#endif
+	if(report)
+		*report = rep;
+	return 0;
+}
+
+/*------------------------------------------------- 
+	#       5. Simplification      #
+------------------------------------------------- */
+/*	Edge collapse with Garland-Heckbert quadrics over welded corners.
+	Every position keeps the planes of the triangles around it
+	(weighted by area) and a collapse moves one position onto a
+	neighbour, so no new points appear and every corner keeps its
+	texture and normal. Positions shared by several corners (UV or
+	normal seams) and non-manifold ones never move; border ones only
+	slide along their border, held there by planes standing on the
+	border edges. Each pass sorts the candidates by error and takes
+	the cheap ones that don't flip a triangle, pinch the surface or
+	touch the ring of a collapse made earlier in the same pass.	*/
+
+#define QUADRIC_BORDER 10.0	//border planes against the area of the triangle planes
+#define SIMPLIFY_SHARE 3	//a pass takes from the cheapest 1/SIMPLIFY_SHARE of the candidates
+
+enum {POS_FREE, POS_BORDER, POS_LOCKED};
+
+typedef struct {
+	double a[10];	//xx xy xz xw yy yz yw zz zw ww of the symmetric 4x4
+	double w;	//weight of the planes summed in
+} quadric_t;
+
+typedef struct {
+	float cost;
+	int from, to;	//corners: from's position moves onto to's
+} collapse_t;
+
+typedef struct {
+	int *corner, *uniq;	//as in optimize_t
+	int *tri;	//3 * ntri corners
+	int *pos;	//corner -> position
+	vector *point;	//positions
+	quadric_t *q;
+	unsigned char *kind;	//POS_*
+	int *start, *ring;	//position -> live triangles, rebuilt every pass; ring then gets the Forsyth order
+	int *mark, *seen;	//pass a position was touched in, link test stamps
+	int stamp;
+	collapse_t *c;	//the best move of every position
+	int *order;	//corner -> the one it collapsed onto, then the new vertex numbers
+} simplify_t;
+
+static void QuadricPlane(quadric_t *q, const double n[3], double d, double w){
+	const double p[4] = {n[0], n[1], n[2], d};
+	for(int i = 0, k = 0; i < 4; i++)
+		for(int j = i; j < 4; j++)
+			q->a[k++] += w * p[i] * p[j];
+	q->w += w;
+}
+
+//mean squared distance of p to the planes of a + b
+static float QuadricError(const quadric_t *a, const quadric_t *b, const float *p){
+	double q[10], x = p[X], y = p[Y], z = p[Z], w = a->w + b->w;
+	for(int k = 0; k < 10; k++)
+		q[k] = a->a[k] + b->a[k];
+	double e = x * (q[0] * x + 2.0 * (q[1] * y + q[2] * z + q[3])) +
+		y * (q[4] * y + 2.0 * (q[5] * z + q[6])) + z * (q[7] * z + 2.0 * q[8]) + q[9];
+	return e > 0.0 && w > 0.0 ? (float)(e / w) : 0.0f;
+}
+
+static inline uint32_t HashPoint(const float *p){
+	uint32_t h[3];
+	float f[3] = {p[X] + 0.0f, p[Y] + 0.0f, p[Z] + 0.0f};	//-0 is 0
+	memcpy(h, f, sizeof(h));
+	h[0] = h[0] * 0x9E3779B1u ^ h[1] * 0x85EBCA77u ^ h[2] * 0xC2B2AE3Du;
+	return h[0] ^ (h[0] >> 15);
+}
+
+/*	Corners at equal coordinates share a position. Returns the count */
+static int WeldPositions(const wavefront_t *obj, simplify_t *s, int nu){
+	size_t size = 16;
+	while(size < (size_t)nu * 2)
+		size *= 2;
+	int *slot = malloc(sizeof(int) * size), np = 0;
+	if(slot == NULL)
+		return -1;
+	memset(slot, 0xFF, sizeof(int) * size);
+	for(int u = 0; u < nu; u++){
+		const float *p = obj->vertex[obj->index[s->uniq[u]].v - 1];
+		size_t h = HashPoint(p) & (size - 1);
+		for(;; h = (h + 1) & (size - 1)){
+			if(slot[h] < 0){
+				slot[h] = np;
+				memcpy(s->point[np++], p, sizeof(vector));
+				break;
+			}
+			const float *o = s->point[slot[h]];
+			if(o[X] == p[X] && o[Y] == p[Y] && o[Z] == p[Z])
+				break;
+		}
+		s->pos[u] = slot[h];
+	}
+	free(slot);
+	return np;
+}
+
+/*	Kinds and quadrics of the positions, from the triangles and the
+	edges between positions counted in a hash. 0 - ok, -1 - no memory */
+static int ClassifyPositions(simplify_t *s, int ntri, int nu, int np){
+	size_t size = 16;
+	while(size < (size_t)ntri * 6)
+		size *= 2;
+	uint64_t *key = malloc(sizeof(uint64_t) * size);
+	int *count = calloc(size, sizeof(int)), *corners = calloc(np ? np : 1, sizeof(int));
+	int *used = calloc(nu ? nu : 1, sizeof(int));
+	int ok = key && count && corners && used;
+	size_t *slot = ok ? malloc(sizeof(size_t) * 3 * (ntri ? ntri : 1)) : NULL;
+	if((ok = ok && slot) != 0){
+		memset(s->q, 0, sizeof(quadric_t) * np);
+		memset(s->kind, POS_FREE, np);
+		for(int i = 0; i < 3 * ntri; i++)
+			if(!used[s->tri[i]]++)
+				corners[s->pos[s->tri[i]]]++;
+		for(int p = 0; p < np; p++)
+			if(corners[p] > 1)	//a seam
+				s->kind[p] = POS_LOCKED;
+		for(int i = 0; i < 3 * ntri; i++){
+			uint32_t a = s->pos[s->tri[i]], b = s->pos[s->tri[i - i % 3 + (i % 3 + 1) % 3]];
+			uint64_t k = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+			size_t h = (k * 0x9E3779B97F4A7C15ull >> 32) & (size - 1);
+			while(count[h] && key[h] != k)
+				h = (h + 1) & (size - 1);
+			key[h] = k;
+			count[h]++;
+			slot[i] = h;
+		}
+		memset(corners, 0, sizeof(int) * np);	//border edges now
+		for(int t = 0; t < ntri; t++){
+			const int *c = s->tri + 3 * t;
+			vec4_t p0 = vec4_load3(s->point[s->pos[c[0]]]);
+			vec4_t n = vec4_cross3(vec4_sub(vec4_load3(s->point[s->pos[c[1]]]), p0),
+				vec4_sub(vec4_load3(s->point[s->pos[c[2]]]), p0));
+			double len = vec4_length3(n);
+			if(len <= 0.0)
+				continue;
+			double nrm[3] = {n.f[X] / len, n.f[Y] / len, n.f[Z] / len};
+			double d = -(nrm[0] * p0.f[X] + nrm[1] * p0.f[Y] + nrm[2] * p0.f[Z]);
+			for(int k = 0; k < 3; k++)
+				QuadricPlane(&s->q[s->pos[c[k]]], nrm, d, 0.5 * len);
+			for(int k = 0; k < 3; k++){
+				int a = s->pos[c[k]], b = s->pos[c[(k + 1) % 3]], e = count[slot[3 * t + k]];
+				if(e > 2)
+					s->kind[a] = s->kind[b] = POS_LOCKED;
+				if(e != 1)
+					continue;
+				vec4_t pa = vec4_load3(s->point[a]);
+				vec4_t edge = vec4_sub(vec4_load3(s->point[b]), pa);
+				vec4_t side = vec4_cross3(edge, n);	//in the edge, across the triangle
+				double sl = vec4_length3(side), el2 = vec4_dot3(edge, edge);
+				if(sl > 0.0){
+					double bn[3] = {side.f[X] / sl, side.f[Y] / sl, side.f[Z] / sl};
+					double bd = -(bn[0] * pa.f[X] + bn[1] * pa.f[Y] + bn[2] * pa.f[Z]);
+					QuadricPlane(&s->q[a], bn, bd, QUADRIC_BORDER * el2);
+					QuadricPlane(&s->q[b], bn, bd, QUADRIC_BORDER * el2);
+				}
+				corners[a]++;
+				corners[b]++;
+			}
+		}
+		for(int p = 0; p < np; p++)
+			if(s->kind[p] == POS_FREE && corners[p])
+				s->kind[p] = corners[p] == 2 ? POS_BORDER : POS_LOCKED;	//more - borders meet there
+	}
+	free(key);
+	free(count);
+	free(corners);
+	free(used);
+	free(slot);
+	return ok ? 0 : -1;
+}
+
+//position -> live triangles, the counting sort of BuildAdjacency
+static void RingPositions(simplify_t *s, int ntri, int np){
+	memset(s->start, 0, sizeof(int) * (np + 1));
+	for(int i = 0; i < 3 * ntri; i++)
+		s->start[s->pos[s->tri[i]]]++;
+	for(int p = 1; p < np; p++)
+		s->start[p] += s->start[p - 1];
+	s->start[np] = 3 * ntri;
+	for(int i = 3 * ntri - 1; i >= 0; i--)
+		s->ring[--s->start[s->pos[s->tri[i]]]] = i / 3;
+}
+
+//live triangles having both positions
+static int SharedTriangles(const simplify_t *s, int a, int b){
+	int n = 0;
+	for(int i = s->start[a]; i < s->start[a + 1]; i++){
+		const int *c = s->tri + 3 * s->ring[i];
+		n += s->pos[c[0]] == b || s->pos[c[1]] == b || s->pos[c[2]] == b;
+	}
+	return n;
+}
+
+static int CompareCollapse(const void *a, const void *b){
+	float x = ((const collapse_t *)a)->cost, y = ((const collapse_t *)b)->cost;
+	return (x > y) - (x < y);
+}
+
+/*	a moving onto b neither flips a triangle around a nor joins two
+	positions that have more neighbours in common than the triangles
+	on the edge (which would pinch the surface).	*/
+static int CanCollapse(simplify_t *s, int a, int b, int stamp){
+	const float *to = s->point[b];
+	for(int i = s->start[b]; i < s->start[b + 1]; i++){
+		const int *c = s->tri + 3 * s->ring[i];
+		for(int k = 0; k < 3; k++)
+			s->seen[s->pos[c[k]]] = stamp;
+	}
+	int common = 0, shared = 0;
+	for(int i = s->start[a]; i < s->start[a + 1]; i++){
+		const int *c = s->tri + 3 * s->ring[i];
+		int k = s->pos[c[0]] == a ? 0 : s->pos[c[1]] == a ? 1 : 2;
+		int p1 = s->pos[c[(k + 1) % 3]], p2 = s->pos[c[(k + 2) % 3]];
+		if(p1 == b || p2 == b){
+			shared++;
+			continue;
+		}
+		for(int j = 0; j < 2; j++){
+			int p = j ? p2 : p1;
+			if(s->seen[p] == stamp){
+				s->seen[p] = -stamp;	//counted
+				common++;
+			}
+		}
+		vec4_t q1 = vec4_load3(s->point[p1]), q2 = vec4_load3(s->point[p2]);
+		vec4_t before = vec4_cross3(vec4_sub(q1, vec4_load3(s->point[a])), vec4_sub(q2, vec4_load3(s->point[a])));
+		vec4_t after = vec4_cross3(vec4_sub(q1, vec4_load3(to)), vec4_sub(q2, vec4_load3(to)));
+		if(vec4_dot3(before, after) <= 0.0f)
+			return 0;
+	}
+	return common <= shared;
+}
+
+/*	One pass; returns the triangles left and raises *error to the
+	dearest collapse made. Only the cheapest move of each position
+	is a candidate.	*/
+static int CollapsePass(simplify_t *s, int ntri, int np, int target, int pass, float *error){
+	RingPositions(s, ntri, np);
+	for(int p = 0; p < np; p++)
+		s->c[p].from = -1;
+	for(int t = 0; t < ntri; t++)
+		for(int k = 0; k < 3; k++){
+			int ca = s->tri[3 * t + k], cb = s->tri[3 * t + (k + 1) % 3];
+			int a = s->pos[ca], b = s->pos[cb];
+			int border = s->kind[a] != POS_FREE && s->kind[b] != POS_FREE &&
+				SharedTriangles(s, a, b) == 1;	//no twin brings the other way
+			for(int dir = 0; dir < 1 + border; dir++){
+				int from = dir ? cb : ca, to = dir ? ca : cb, p = s->pos[from];
+				if(s->kind[p] == POS_LOCKED || (s->kind[p] == POS_BORDER && !border))
+					continue;
+				float cost = QuadricError(&s->q[p], &s->q[s->pos[to]], s->point[s->pos[to]]);
+				if(s->c[p].from < 0 || cost < s->c[p].cost){
+					s->c[p].cost = cost;
+					s->c[p].from = from;
+					s->c[p].to = to;
+				}
+			}
+		}
+	int nc = 0;
+	for(int p = 0; p < np; p++)
+		if(s->c[p].from >= 0)
+			s->c[nc++] = s->c[p];
+	qsort(s->c, nc, sizeof(collapse_t), CompareCollapse);
+	int live = ntri, done = 0, limit = nc / SIMPLIFY_SHARE + 1;
+	for(int i = 0; i < nc && live > target && (i < limit || done == 0); i++){
+		int a = s->pos[s->c[i].from], b = s->pos[s->c[i].to];
+		if(s->mark[a] == pass || s->mark[b] == pass || !CanCollapse(s, a, b, ++s->stamp))
+			continue;
+		for(int j = s->start[a]; j < s->start[a + 1]; j++){
+			int *c = s->tri + 3 * s->ring[j];
+			for(int k = 0; k < 3; k++)
+				s->mark[s->pos[c[k]]] = pass;
+		}
+		live -= SharedTriangles(s, a, b);
+		for(int j = 0; j < 10; j++)
+			s->q[b].a[j] += s->q[a].a[j];
+		s->q[b].w += s->q[a].w;
+		s->order[s->c[i].from] = s->c[i].to;
+		if(s->c[i].cost > *error)
+			*error = s->c[i].cost;
+		done++;
+	}
+	if(done == 0)
+		return ntri;
+	int n = 0;
+	for(int t = 0; t < ntri; t++){
+		int c0 = s->order[s->tri[3 * t]], c1 = s->order[s->tri[3 * t + 1]], c2 = s->order[s->tri[3 * t + 2]];
+		if(s->pos[c0] == s->pos[c1] || s->pos[c1] == s->pos[c2] || s->pos[c2] == s->pos[c0])
+			continue;
+		s->tri[3 * n] = c0;
+		s->tri[3 * n + 1] = c1;
+		s->tri[3 * n + 2] = c2;
+		n++;
+	}
+	return n;
+}
+
+static wavefront_t *SimplifyMesh(const wavefront_t *obj, simplify_t *s, float ratio, float *error){
+	int nu = WeldCorners(obj, s->corner, s->uniq), np, ntri = 0, k = 0;
+	if(nu < 0 || (np = WeldPositions(obj, s, nu)) < 0)
+		return NULL;
+	ring_t ring = {NULL, NULL, NULL, 0};
+	for(int f = 0; f < obj->fc; f++, ntri += k){
+		if((k = TriangulateFace(obj, f, s->tri + 3 * ntri, &ring)) < 0)
+			break;
+		for(int i = 3 * ntri; i < 3 * (ntri + k); i++)
+			s->tri[i] = s->corner[s->tri[i]];
+	}
+	free(ring.p);
+	if(k < 0 || ClassifyPositions(s, ntri, nu, np) != 0)
+		return NULL;
+	int target = (int)(ratio * ntri + 0.5f);
+	float err = 0.0f;
+	for(int u = 0; u < nu; u++)
+		s->order[u] = u;
+	memset(s->mark, 0, sizeof(int) * np);
+	memset(s->seen, 0, sizeof(int) * np);
+	for(int pass = 1; ntri > target; pass++){
+		int left = CollapsePass(s, ntri, np, target, pass, &err);
+		if(left == ntri)
+			break;
+		ntri = left;
+	}
+	if(ForsythOrder(s->tri, ntri, nu, s->ring) != 0)
+		return NULL;
+	int nv = 0;
+	memset(s->order, 0xFF, sizeof(int) * nu);
+	for(int i = 0; i < 3 * ntri; i++)
+		if(s->order[s->ring[i]] < 0)
+			s->order[s->ring[i]] = nv++;
+	wavefront_t *lod = NewWavefront(sizeof(vector) * 3 * nv + (sizeof(polygon_t) + sizeof(uint32_t)) * 3 * ntri +
+		sizeof(int) * (2 * ntri + 1), 7);
+	if(lod == NULL)
+		return NULL;
+	lod->vertex = ArenaAlloc(lod, sizeof(vector) * (nv ? nv : 1));
+	lod->texture = obj->vtc ? ArenaAlloc(lod, sizeof(vector) * (nv ? nv : 1)) : NULL;
+	lod->normal = obj->vnc ? ArenaAlloc(lod, sizeof(vector) * (nv ? nv : 1)) : NULL;
+	lod->index = ArenaAlloc(lod, sizeof(polygon_t) * 3 * (ntri ? ntri : 1));
+	lod->face = ArenaAlloc(lod, sizeof(int) * (ntri + 1));
+	lod->tri = ArenaAlloc(lod, sizeof(uint32_t) * 3 * (ntri ? ntri : 1));
+	lod->tface = ArenaAlloc(lod, sizeof(int) * (ntri ? ntri : 1));
+	if(!lod->vertex || (obj->vtc && !lod->texture) || (obj->vnc && !lod->normal) || !lod->index ||
+			!lod->face || !lod->tri || !lod->tface){
+		RemoveWavefront(lod);
+		return NULL;
+	}
+	static const vector zero = {0.0f, 0.0f, 0.0f};
+	for(int u = 0; u < nu; u++){
+		int v = s->order[u];
+		if(v < 0)
+			continue;
+		const polygon_t *c = &obj->index[s->uniq[u]];
+		memcpy(lod->vertex[v], obj->vertex[c->v - 1], sizeof(vector));
+		if(lod->texture)
+			memcpy(lod->texture[v], c->vt ? obj->texture[c->vt - 1] : zero, sizeof(vector));
+		if(lod->normal)
+			memcpy(lod->normal[v], c->vn ? obj->normal[c->vn - 1] : zero, sizeof(vector));
+	}
+	for(int i = 0; i < 3 * ntri; i++){
+		int v = s->order[s->ring[i]];
+		lod->index[i].v = v + 1;
+		lod->index[i].vt = lod->texture ? v + 1 : 0;
+		lod->index[i].vn = lod->normal ? v + 1 : 0;
+		lod->tri[i] = v;
+	}
+	for(int f = 0; f <= ntri; f++)
+		lod->face[f] = 3 * f;
+	for(int f = 0; f < ntri; f++)
+		lod->tface[f] = f;
+	lod->vc = nv;
+	lod->vtc = lod->texture ? nv : 0;
+	lod->vnc = lod->normal ? nv : 0;
+	lod->fc = lod->tc = ntri;
+	WavefrontCalculateBounds(lod);
+	*error = sqrtf(err);
+	return lod;
+}
+
+wavefront_t *SimplifyWavefront(const wavefront_t *obj, float ratio, float *error){
+	int pc = obj->face[obj->fc], ntri = 0;
+	for(int f = 0; f < obj->fc; f++)
+		ntri += FACE_SIZE(obj, f) > 2 ? FACE_SIZE(obj, f) - 2 : 0;
+	size_t p = pc ? pc : 1, n = ntri ? ntri : 1;
+	simplify_t s = {malloc(sizeof(int) * p), malloc(sizeof(int) * p), malloc(sizeof(int) * 3 * n),
+		malloc(sizeof(int) * p), malloc(sizeof(vector) * p), malloc(sizeof(quadric_t) * p), malloc(p),
+		malloc(sizeof(int) * (p + 1)), malloc(sizeof(int) * 3 * n), malloc(sizeof(int) * p),
+		malloc(sizeof(int) * p), 0, malloc(sizeof(collapse_t) * p), malloc(sizeof(int) * p)};
+	wavefront_t *lod = NULL;
+	float err = 0.0f;
+	if(s.corner && s.uniq && s.tri && s.pos && s.point && s.q && s.kind && s.start && s.ring &&
+			s.mark && s.seen && s.c && s.order)
+		lod = SimplifyMesh(obj, &s, ratio < 1.0f ? ratio : 1.0f, &err);
+	free(s.corner);
+	free(s.uniq);
+	free(s.tri);
+	free(s.pos);
+	free(s.point);
+	free(s.q);
+	free(s.kind);
+	free(s.start);
+	free(s.ring);
+	free(s.mark);
+	free(s.seen);
+	free(s.c);
+	free(s.order);
+	if(lod == NULL){
+		fprintf(stderr," (err) wavefront.c: Can't allocate the simplified mesh\n");
+		return NULL;
+	}
+#ifdef DEBUG
+	printf("(dbg) wavefront.c: SIMPLIFIED %d TRIANGLES INTO %d, ERROR %g\n", ntri, lod->tc, err);
+#endif
+	if(error)
+		*error = err;
+	return lod;
+}
+
+/*------------------------------------------------- 
+	#       6. Parser Benchmark      #
+------------------------------------------------- */
+
+#define BENCH_RUNS 3	//at least, the best one counts
+
+static int SameArray(const void *a, const void *b, size_t size){
+	return size == 0 || memcmp(a, b, size) == 0;
+}
+
+static int SameWavefront(const wavefront_t *a, const wavefront_t *b){
+	if(a->vc != b->vc || a->vtc != b->vtc || a->vnc != b->vnc || a->fc != b->fc || a->tc != b->tc)
+		return 0;
+	return SameArray(a->vertex, b->vertex, sizeof(vector) * a->vc) &&
+		SameArray(a->texture, b->texture, sizeof(vector) * a->vtc) &&
+		SameArray(a->normal, b->normal, sizeof(vector) * a->vnc) &&
+		SameArray(a->face, b->face, sizeof(int) * (a->fc + 1)) &&
+		SameArray(a->index, b->index, sizeof(polygon_t) * a->face[a->fc]) &&
+		SameArray(a->tri, b->tri, sizeof(uint32_t[3]) * a->tc) &&
+		SameArray(a->tface, b->tface, sizeof(int) * a->tc);
+}
+
+/*	Parses the mapped file (never the binary cache) serially, then with
+	2, 4 ... threads up to max (0 - all CPUs) or as many as the file
+	has chunks for; every result has to match the serial one to the bit.	*/
+void WavefrontParseBench(const char *filename, int max){
+	size_t len = 0;
+	const char *buffer = MapFile(filename, &len);
+	if(buffer == NULL){
+		fprintf(stderr," (err) wavefront.c: Failed to map %s\n", filename);
+		return;
+	}
+	int saved = Threads, cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(max <= 0)
+		max = cpus > 0 ? cpus : 1;
+	wavefront_t *serial = NULL;
+	double base = 0.0;
+	for(int n = 1; ; n = 2 * n < max ? 2 * n : max){
+		wavefront_t *obj = NULL;
+		double best = INFINITY, t0 = BenchNow();
+		Threads = n;
+		if(ParseThreads(len) < n){	//a chunk per CHUNK_MIN at most
+			printf("wavefront.c: %zu bytes are parsed on %i threads at most\n", len, ParseThreads(len));
+			break;
+		}
+		for(int runs = 0; runs < BENCH_RUNS || BenchNow() - t0 < BENCH_SECONDS; runs++){
+			if(obj != NULL && obj != serial)
+				RemoveWavefront(obj);
+			double t = BenchNow();
+			if((obj = ParseWavefront(buffer, len)) == NULL)
+				break;
+			t = BenchNow() - t;
+			best = t < best ? t : best;
+			if(serial == NULL)
+				serial = obj;
+		}
+		if(obj == NULL)
+			break;
+		if(n == 1)
+			base = best;
+		int same = SameWavefront(obj, serial);
+		printf("wavefront.c: %2i threads %8.2f ms %8.1f MB/s %5.2fx%s\n", n, best * 1e3,
+			len / best * 1e-6, base / best, same ? "" : "  MISMATCH");
+		if(obj != serial)
+			RemoveWavefront(obj);
+		if(n == max)
+			break;
+	}
+	if(serial != NULL)
+		printf("wavefront.c: %s, %zu bytes, %i faces, %i triangles\n", filename, len, serial->fc, serial->tc);
+	else
+		fprintf(stderr," (err) wavefront.c: Failed to parse %s\n", filename);
+	Threads = saved;
+	if(serial != NULL)
+		RemoveWavefront(serial);
+	munmap((void *)buffer, len);
 }
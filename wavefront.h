@@ -9,65 +9,24 @@
 #ifndef WAVEFRONT_H_SENTRY
 #define WAVEFRONT_H_SENTRY
 
-/*------------------------------------------------- 
-	#        1.MATH HELPERS    #
-------------------------------------------------- */
-
-enum {X = 0, Y = 1, Z = 2};
-
-typedef float vector[3];
-
-#define VEC_ABS(v) ( sqrtf((v)[X]*(v)[X] + (v)[Y]*(v)[Y] + (v)[Z]*(v)[Z]) )
-
-static inline void vec_add(vector a, vector b, vector c){
-	c[X] = a[X] + b[X];
-	c[Y] = a[Y] + b[Y];
-	c[Z] = a[Z] + b[Z];
-};
-
-static inline void vec_sub(vector a, vector b, vector c){
-	c[X] = a[X] - b[X];
-	c[Y] = a[Y] - b[Y];
-	c[Z] = a[Z] - b[Z];
-};
-
-static inline void vec_scalar_mul(vector v, float k, vector u){
-	u[X] = v[X] * k;
-	u[Y] = v[Y] * k;
-	u[Z] = v[Z] * k;
-};
-
-static inline void vec_cross(vector a, vector b, vector c){
-	c[X] = a[Y]*b[Z] - a[Z]*b[Y];
-	c[Y] = a[Z]*b[X] - a[X]*b[Z];
-	c[Z] = a[X]*b[Y] - a[Y]*b[X];
-};
-
-static inline float vec_dot(vector a, vector b){
-	return a[X]*b[X] + a[Y]*b[Y] + a[Z]*b[Z];
-};
-
-static inline void vec_normalize(vector v){
-	float l  = VEC_ABS(v);
-	if(l != 0){
-		v[X] = v[X] / l;
-		v[Y] = v[Y] / l;
-		v[Z] = v[Z] / l;
-	};
-};
+#include <stddef.h>
+#include <stdint.h>
+#include "vecmath.h"
 
 /*------------------------------------------------- 
-	#        2.WAVEFRONT     #
+	#        1.WAVEFRONT     #
 ------------------------------------------------- */
 
 #define VERTEX(objptr,n,coord) ((objptr)->vertex[(n)][(coord)])
 #define TEXTURE(objptr,n,coord) ((objptr)->texture[(n)][(coord)])
 #define NORMAL(objptr,n,coord) ((objptr)->normal[(n)][(coord)])
-#define FACE(objptr,n) (((objptr)->face)[(n)])
+#define FACE(objptr,n) ((objptr)->index + (objptr)->face[(n)])
+#define FACE_SIZE(objptr,n) ((objptr)->face[(n) + 1] - (objptr)->face[(n)])
 /*	VERTEX - get coordinate of "n" vertex in "objptr" obj
 	TEXTURE - get texture coordinate
 	NORMAL - get normal-vector coordinates
-	FACE - get face (polygon) by his number n	*/
+	FACE - get first point of face (polygon) by his number n
+	FACE_SIZE - get number of points in face n	*/
 
 #define COPY_POINT(obj,v,vector) do {\
 		(vector)[X] = VERTEX((obj), (v) - 1, X);\
@@ -88,25 +47,74 @@ static inline void vec_normalize(vector v){
 	}while(0)
 
 typedef struct polygon {
-	int v;	//0 - error; v > 0 <=> VERTEX(obj, obj->face->v - 1, X)
+	int v;	//0 - error; v > 0 <=> VERTEX(obj, v - 1, X)
 	int vt; //can be zero
 	int vn; //can be zero
-	struct polygon *next;
 } polygon_t;
 
 typedef struct {
-	float **vertex;
-	float **texture; //(optional)
-	float **normal; //(optional)
-	polygon_t **face;
+	void *(*Alloc)(size_t size, void *user);
+	void (*Free)(void *ptr, size_t size, void *user);	//size as passed to Alloc
+	void *user;
+} wavefront_allocator_t;
+
+typedef struct wavefront_block wavefront_block_t;
+typedef struct wavefront_adjacency wavefront_adjacency_t;
+
+/*	All data lives in flat arrays: face n is the run of points
+	index[face[n]] .. index[face[n+1] - 1], in file order.	*/
+typedef struct {
+	int vc, vtc, vnc, fc;	//vertex, texture, normal and face count
+	vector *vertex;
+	vector *texture; //(optional)
+	vector *normal; //(optional)
+	polygon_t *index;	//points of all faces
+	int *face;	//fc + 1 offsets into index
+	uint32_t *tri;	//tc triangles cut from the faces at load, 3 vertex numbers (from 0) each
+	int *tface;	//the face every triangle came from
+	int tc;
+	void *map;	//binary cache mapping the arrays live in, or NULL
+	size_t maplen;
+	wavefront_block_t *arena;	//everything else, freed at once
+	vector bmin, bmax;	//axis aligned bounding box
+	vector center;	//and bounding sphere, both kept by Turn/Move/Scale
+	float radius;
+	wavefront_adjacency_t *adj;	//vertex -> faces and dirty vertices, built by *Normals()
+	wavefront_allocator_t alloc;
 } wavefront_t;
 
+typedef struct {
+	int corners;	//points of all faces before
+	int vertices;	//distinct (v, vt, vn) corners, the vertex count after
+	int triangles;
+	float acmr_before, acmr_after;	//vertex transforms per triangle, 16 entry FIFO cache
+} wavefront_optimize_t;
+
 //FUNCTIONS
 wavefront_t *LoadWavefront(char *filename);
+wavefront_t *LoadMappedWavefront(const char *filename); //zero-copy, parses the mmap()ed file
 wavefront_t *LoadMemoryWavefront(const char *buffer);
+int SaveWavefrontCache(wavefront_t *obj, const char *filename); //0 - ok, -1 - error
+wavefront_t *LoadWavefrontCache(const char *filename); //mmap()s, no deserialisation
+void WavefrontSetCache(int enable); //Load*Wavefront(foo.obj) reads/writes foo.obj.cache
+void WavefrontSetAllocator(const wavefront_allocator_t *alloc); //for meshes loaded later, NULL - malloc
+void WavefrontSetThreads(int threads); //loader threads, 0 - all CPUs (default), 1 - serial
 void RemoveWavefront(wavefront_t *obj);
+/*	Welds corners so that v = vt = vn, cuts faces into triangles and
+	orders them for the vertex cache. Vertex numbers change, report
+	may be NULL. 0 - ok, -1 - out of memory, obj unchanged	*/
+int WavefrontOptimize(wavefront_t *obj, wavefront_optimize_t *report);
+/*	A new mesh of about ratio * tc triangles made by quadric error
+	edge collapse, welded and ordered as by WavefrontOptimize. UV and
+	normal seams stay where they are, borders only lose points along
+	themselves. error (may be NULL) gets how far the surface moved,
+	roughly, in obj's units. NULL - out of memory	*/
+wavefront_t *SimplifyWavefront(const wavefront_t *obj, float ratio, float *error);
 void WavefrontPrintLog(wavefront_t *obj);
-void WavefrontCalculateNormals(wavefront_t *obj);
+void WavefrontParseBench(const char *filename, int threads); //MB/s and speedup for 1 .. threads (0 - all CPUs)
+void WavefrontCalculateNormals(wavefront_t *obj); //one per vertex, all of them, in parallel
+void WavefrontUpdateNormals(wavefront_t *obj); //only around vertices Move/SetVertex touched since
+void WavefrontCalculateBounds(wavefront_t *obj); //tight again after Move/SetVertex
 void TurnWavefront(wavefront_t *obj, float alpha, float beta, float gamma);
 void MoveWavefront(wavefront_t *obj, float dx, float dy, float dz);
 void ScaleWavefront(wavefront_t *obj, float multipler);